@@ -0,0 +1,45 @@
+# Turns the AprilTag layouts in fieldmaps/ into src/main/include/fieldmaps.h.
+# Each fieldmaps/<name>.json becomes a constexpr field_<name>, built by MakeFieldMap (FieldMap.hpp).
+# Layouts are in WPILib's AprilTagFieldLayout format, so an official one can be dropped right in.
+# Gradle runs this before compiling; run it by hand with `python fieldmap.py` if you like.
+import json, math, os
+
+
+HEADER = "src/main/include/fieldmaps.h"
+
+
+def yaw(q): # Rotation about the vertical axis, from the quaternion
+    return math.atan2(2 * (q["W"] * q["Z"] + q["X"] * q["Y"]), 1 - 2 * (q["Y"] * q["Y"] + q["Z"] * q["Z"]))
+
+
+def convert(name, path):
+    layout = json.load(open(path))
+    lines = ["constexpr ApriltagPosition apriltags_" + name + "[] = {"]
+    for tag in layout["tags"]:
+        t = tag["pose"]["translation"]
+        a = yaw(tag["pose"]["rotation"]["quaternion"])
+        if abs(a) < 1e-9:
+            a = 0.0
+        lines.append("    { %d, %r, %r, %r, %r, %r }," % (tag["ID"], float(t["x"]), float(t["y"]), a, math.sin(a), math.cos(a)))
+    lines.append("};")
+    lines.append("constexpr auto field_" + name + " = MakeFieldMap(apriltags_" + name + ");")
+    lines.append("static_assert(!field_" + name + ".duplicateIDs, \"" + path + " has two tags with the same ID\");")
+    return "\n".join(lines)
+
+
+out = [
+    "/* GENERATED by fieldmap.py from the layouts in fieldmaps/ - don't edit this, edit the JSON. */",
+    "#pragma once",
+    "",
+    "#include \"FieldMap.hpp\"",
+    "",
+]
+for f in sorted(os.listdir("fieldmaps")):
+    if f.endswith(".json"):
+        out.append(convert(f[:-5], "fieldmaps/" + f))
+        out.append("")
+
+text = "\n".join(out)
+if not os.path.exists(HEADER) or open(HEADER).read() != text: # Don't touch it if nothing changed, or everything recompiles
+    open(HEADER, "w").write(text)
+    print("Wrote", HEADER)
@@ -0,0 +1,113 @@
+/* Arm map builder. Host tool, not robot code.
+    Sweeps every cell of the arm's joint space on every core, checks it against the joint limits and obstacles in ArmPlannerConstants,
+    and writes the result as a bitmap for ArmMap (ArmMap.hpp) to load on the robot.
+    Build the armMap component for desktop (./gradlew build), then run what it installs under build/install/armMap from the project directory:
+    it writes src/main/deploy/armmap.bin (or wherever argv[1] says), which gets deployed with everything else. Rerun it whenever the obstacles or limits change; the robot won't use one built from old ones.
+*/
+
+#define PI 3.141592
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include <ArmMap.hpp>
+#include <ParallelFor.hpp>
+
+
+const int N = ArmMap::Size;
+
+
+/**
+ * Whether segments from (sx, sy) to each (bx[i], by[i]) go through a box; hit[i] goes to 1 if so. The same slab test as SegmentHitsBox,
+ * but branch-free over whole arrays so the compiler can vectorize it. hit is doubles, not bools, to keep every lane the same width.
+ */
+void segmentsHitBox(double sx, double sy, const double* bx, const double* by, const ArmBox& box, double* hit){
+    for (int i = 0; i < N; i ++){
+        double dx = bx[i] - sx;
+        double dy = by[i] - sy;
+        // Zero-length directions are nudged off zero; the slab's t range then covers everything or nothing, same as the special case in SegmentHitsBox
+        dx = std::abs(dx) < 1e-12 ? 1e-12 : dx;
+        dy = std::abs(dy) < 1e-12 ? 1e-12 : dy;
+        double txa = (box.minX - sx) / dx;
+        double txb = (box.maxX - sx) / dx;
+        double tya = (box.minY - sy) / dy;
+        double tyb = (box.maxY - sy) / dy;
+        double t0 = std::max(std::max(std::min(txa, txb), std::min(tya, tyb)), 0.0);
+        double t1 = std::min(std::min(std::max(txa, txb), std::max(tya, tyb)), 1.0);
+        hit[i] = t0 <= t1 ? 1.0 : hit[i];
+    }
+}
+
+
+int main(int argc, char** argv){
+    const char* out = argc > 1 ? argv[1] : "src/main/deploy/armmap.bin";
+    ArmPlannerConstants constants;
+    std::vector<uint8_t> bits(ArmMap::Bytes, 0);
+
+    // Cell centers, and their cos and sin, once
+    double shoulder[N], elbow[N], shoulderCos[N], shoulderSin[N], elbowCos[N], elbowSin[N];
+    for (int i = 0; i < N; i ++){
+        shoulder[i] = ArmMap::ShoulderMin + (i + 0.5) * ArmMap::CellSize;
+        elbow[i] = ArmMap::ElbowMin + (i + 0.5) * ArmMap::CellSize;
+        shoulderCos[i] = cos(shoulder[i]);
+        shoulderSin[i] = sin(shoulder[i]);
+        elbowCos[i] = cos(elbow[i]);
+        elbowSin[i] = sin(elbow[i]);
+    }
+
+    // One shoulder cell per job; each does the whole row of elbow cells at once, as arrays (the FK and box tests vectorize)
+    parallelFor(N, [&](size_t row){
+        double ex = shoulderBarLengthCM * shoulderCos[row];
+        double ey = shoulderBarLengthCM * shoulderSin[row];
+        double hx[N], hy[N];
+        double hit[N];
+        for (int i = 0; i < N; i ++){ // The elbow bar's angle is shoulder + elbow; angle-sum identities keep libm out of the loop
+            hx[i] = ex + elbowBarLengthCM * (shoulderCos[row] * elbowCos[i] - shoulderSin[row] * elbowSin[i]);
+            hy[i] = ey + elbowBarLengthCM * (shoulderSin[row] * elbowCos[i] + shoulderCos[row] * elbowSin[i]);
+            hit[i] = (elbow[i] < constants.minJoints[1]) | (elbow[i] > constants.maxJoints[1]) ? 1.0 : 0.0;
+        }
+        bool shoulderOut = shoulder[row] < constants.minJoints[0] || shoulder[row] > constants.maxJoints[0];
+        for (int o = 0; o < constants.obstacleCount; o ++){
+            const ArmBox& b = constants.obstacles[o];
+            ArmBox box { b.minX - constants.clearance, b.maxX + constants.clearance, b.minY - constants.clearance, b.maxY + constants.clearance };
+            shoulderOut = shoulderOut || SegmentHitsBox(0, 0, ex, ey, box); // The shoulder bar's the same all along the row
+            segmentsHitBox(ex, ey, hx, hy, box, hit);
+        }
+        for (int i = 0; i < N; i ++){
+            if (!shoulderOut && hit[i] == 0){
+                size_t bit = row * N + i;
+                bits[bit / 8] |= 1 << (bit % 8); // Rows are N bits, a whole number of bytes, so no two jobs share a byte
+            }
+        }
+    });
+
+    // Check it against the real thing, ArmAllowed. Cells right on an edge can come out either way from rounding; anything more is a bug
+    std::atomic<long> disagree = 0;
+    std::atomic<long> allowed = 0;
+    parallelFor(N, [&](size_t row){
+        for (int i = 0; i < N; i ++){
+            size_t bit = row * N + i;
+            bool mapped = bits[bit / 8] & (1 << (bit % 8));
+            allowed += mapped;
+            disagree += mapped != ArmAllowed({ shoulder[row], elbow[i] }, constants);
+        }
+    });
+    printf("%ld of %d cells allowed; %ld disagree with ArmAllowed\n", allowed.load(), N * N, disagree.load());
+    if (disagree > N){
+        printf("Too many disagreements - not writing %s\n", out);
+        return 1;
+    }
+
+    ArmMapHeader header { { 'A', 'R', 'M', 'M' }, (uint32_t)N, ArmMap::ShoulderMin, ArmMap::ElbowMin, ArmMap::CellSize, ArmMap::Hash(constants) };
+    FILE* file = fopen(out, "wb");
+    if (!file){
+        printf("Couldn't open %s\n", out);
+        return 1;
+    }
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(bits.data(), 1, bits.size(), file);
+    fclose(file);
+    printf("Wrote %s\n", out);
+}
@@ -0,0 +1,221 @@
+/* Benchmarks for the control loop's hot paths. Host tool, not robot code.
+    Motors, sensors and time are all simulated (FRL/sim), so nothing here needs a robot or a HAL.
+    Run the benchmarks executable from the desktop build with --benchmark_out=results.json, and compare two runs with Google Benchmark's compare.py.
+*/
+
+#define PI 3.141592
+
+#include <cassert>
+#include <cstdio>
+#include <Benchmark.hpp>
+#include <FRL/sim/SimWorld.hpp>
+#include <FRL/sim/SimSensors.hpp>
+#include <FRL/swerve/SwerveModule.hpp>
+#include <FRL/util/vector.hpp>
+#include <arm.hpp>
+#include <ArmKinematics.hpp>
+#include <ArmTrajectory.hpp>
+#include <ArmDynamics.hpp>
+#include <apriltags.h>
+#include <Positionizer.hpp>
+#include <macro++.hpp>
+
+
+void BM_PIDControllerUpdate(benchmark::State& state){
+    SimMotor motor { 1 };
+    PIDController <SimMotor> controller { &motor };
+    controller.constants.P = 0.0005;
+    controller.constants.D = 0.0002;
+    controller.SetCircumference(4096);
+    controller.SetPosition(1024);
+    double position = 0;
+    for (auto _ : state){
+        controller.Update(position);
+        position = position > 4000 ? 0 : position + 37;
+    }
+    benchmark::DoNotOptimize(motor);
+}
+BENCHMARK(BM_PIDControllerUpdate);
+
+
+void BM_ArmInfoUpdate(benchmark::State& state){
+    ArmInfo info;
+    const vector goals[] = { lowPole, highPole, home, pickup };
+    size_t i = 0;
+    for (auto _ : state){
+        info.goal = goals[i ++ % 4];
+        info.Update();
+        benchmark::DoNotOptimize(info);
+    }
+}
+BENCHMARK(BM_ArmInfoUpdate);
+
+
+void BM_ArmIK(benchmark::State& state){
+    double x = 60;
+    for (auto _ : state){
+        JointAngles j = ArmIK(x, 50);
+        benchmark::DoNotOptimize(j);
+        x = x > 150 ? 60 : x + 0.5;
+    }
+}
+BENCHMARK(BM_ArmIK);
+
+
+void BM_ArmFK(benchmark::State& state){
+    double shoulder = 0.3;
+    for (auto _ : state){
+        vector head = ArmFK(shoulder, shoulder - 2);
+        benchmark::DoNotOptimize(head);
+        shoulder = shoulder > 1.5 ? 0.3 : shoulder + 0.01;
+    }
+}
+BENCHMARK(BM_ArmFK);
+
+
+ArmPlanner benchPlanner; // Big (the A* grid lives in it), so not on the stack
+
+
+void BM_ArmPlanCached(benchmark::State& state){
+    ArmJoints goals[PRESET_COUNT];
+    for (int i = 0; i < PRESET_COUNT; i ++){
+        goals[i] = ToArmJoints(armPresets[i].joints);
+    }
+    size_t i = 0;
+    for (auto _ : state){
+        const ArmTrajectory& t = benchPlanner.Plan(goals[i % PRESET_COUNT], goals[(i + 1) % PRESET_COUNT]);
+        benchmark::DoNotOptimize(t);
+        i ++;
+    }
+}
+BENCHMARK(BM_ArmPlanCached);
+
+
+void BM_ArmPlanAroundBumper(benchmark::State& state){
+    ArmJoints start = ToArmJoints(ArmIK(-40, 55)); // Behind the shoulder, low, to in front of the bumper: takes the A*
+    ArmJoints goal = ToArmJoints(ArmIK(10, -5));
+    for (auto _ : state){
+        benchPlanner.Rebuild(); // Empties the cache, so every plan is from scratch. Rebuild's cost is counted too; it's the smaller part
+        const ArmTrajectory& t = benchPlanner.Plan(start, goal);
+        benchmark::DoNotOptimize(t);
+    }
+}
+BENCHMARK(BM_ArmPlanAroundBumper);
+
+
+void BM_ArmTrajectorySample(benchmark::State& state){
+    const ArmTrajectory& t = benchPlanner.Plan(ToArmJoints(armPresets[PRESET_HOME].joints), ToArmJoints(armPresets[PRESET_HIGH_POLE].joints));
+    double time = 0;
+    for (auto _ : state){
+        ArmSample sample = t.Sample(time);
+        benchmark::DoNotOptimize(sample);
+        time = time > t.Duration() ? 0 : time + 0.02;
+    }
+}
+BENCHMARK(BM_ArmTrajectorySample);
+
+
+void BM_ArmDynamicsFeedforward(benchmark::State& state){
+    const ArmTrajectory& t = benchPlanner.Plan(ToArmJoints(armPresets[PRESET_HOME].joints), ToArmJoints(armPresets[PRESET_HIGH_POLE].joints));
+    ArmDynamicsConstants constants;
+    double time = 0;
+    for (auto _ : state){
+        ArmSample sample = t.Sample(time);
+        ArmTorques torques = ArmInverseDynamics(sample, constants, true);
+        double outputs[2] = { ArmJointOutput(0, torques.shoulder, sample.velocity.shoulder, constants), ArmJointOutput(1, torques.elbow, sample.velocity.elbow, constants) };
+        benchmark::DoNotOptimize(outputs);
+        time = time > t.Duration() ? 0 : time + 0.02;
+    }
+}
+BENCHMARK(BM_ArmDynamicsFeedforward);
+
+
+void BM_VectorRotate(benchmark::State& state){
+    vector v { 0.3, 0.7 };
+    for (auto _ : state){
+        v = v.rotate(0.01);
+        benchmark::DoNotOptimize(v);
+    }
+}
+BENCHMARK(BM_VectorRotate);
+
+
+void BM_VectorSpeedLimit(benchmark::State& state){
+    for (auto _ : state){
+        vector v { 0.6, 0.8 };
+        benchmark::DoNotOptimize(v);
+        v.speedLimit(0.5);
+        benchmark::DoNotOptimize(v);
+    }
+}
+BENCHMARK(BM_VectorSpeedLimit);
+
+
+void BM_SmartLoop(benchmark::State& state){
+    double pos = -5000;
+    for (auto _ : state){
+        double r = smartLoop(pos);
+        benchmark::DoNotOptimize(r);
+        pos = pos > 9000 ? -5000 : pos + 13; // Mostly one lap either side, like the callers hand it
+    }
+}
+BENCHMARK(BM_SmartLoop);
+
+
+void BM_SwerveSetToVector(benchmark::State& state){
+    SwerveModule <SimMotor, SimMotor, SimCANCoder> module { SwerveModuleConfig { .speedID = 1, .directionID = 2, .cancoderID = 3, .role = 0, .offset = 0 } };
+    SimCANCoder::ByID(3) -> Set(512);
+    vector translation { 0.2, 0.4 };
+    vector rotation { 0.1, 0 };
+    for (auto _ : state){
+        module.SetToVector(translation, rotation);
+        module.ApplySpeed();
+        translation = translation.rotate(0.05);
+    }
+}
+BENCHMARK(BM_SwerveSetToVector);
+
+
+SwerveModule <SimMotor, SimMotor, SimCANCoder> odometrySwerve { SwerveModuleConfig { .speedID = 11, .directionID = 12, .cancoderID = 13, .role = 0, .offset = 0 } };
+
+void BM_OdometryUpdate(benchmark::State& state){
+    static Odometry <fieldMap, nullptr, &odometrySwerve> odometry ("bench", 0.0001);
+    SimMotor::ByID(11) -> SetState(0, 2000);
+    SimCANCoder::ByID(13) -> Set(700);
+    VisionEstimate est { .hasTargets = true, .valid = true, .pose = { 3, 2 }, .stdDev = 0.1 };
+    double time = 0;
+    size_t tick = 0;
+    for (auto _ : state){
+        time += 0.02;
+        odometry.Use(tick * 0.1, time);
+        if (tick ++ % 5 == 0){ // A camera frame every 100ms, taken 40ms ago
+            odometry.PublishVision(time - 0.04, est);
+        }
+        Position2D pos = odometry.Update();
+        benchmark::DoNotOptimize(pos);
+    }
+}
+BENCHMARK(BM_OdometryUpdate);
+
+
+void BM_MacroInterpreter(benchmark::State& state){
+    const char* path = "macro_benchmark.mcr";
+    FILE* script = fopen(path, "w");
+    for (int i = 0; i < 20; i ++){
+        fprintf(script, "store %d \"value%d\"\ngetStored \"value%d\"\npop\n", i, i, i);
+    }
+    fclose(script);
+    for (auto _ : state){
+        Macro macro { path }; // Parsing is part of it; autos load their macro when they start
+        while (macro.Execute());
+        benchmark::DoNotOptimize(macro.global);
+    }
+    remove(path);
+}
+BENCHMARK(BM_MacroInterpreter);
+
+
+int main(int argc, char** argv){
+    SimClock::Install();
+    return benchmark::RunAll(argc, argv);
+}
@@ -0,0 +1,232 @@
+/* Tiny benchmark harness. Host tool, not robot code.
+    GradleRIO doesn't ship Google Benchmark, so this does the part we use the same way: the same State loop, the same flags, and the same JSON,
+    so Google Benchmark's compare.py (or anything else that reads its output) works on the results.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <regex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace benchmark {
+
+/**
+ * Keep the compiler from optimizing away a value the benchmark computes
+ */
+template <typename T>
+inline void DoNotOptimize(T& value){
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : "+m"(value) : : "memory");
+#else
+    static volatile char sink;
+    sink = *reinterpret_cast<volatile char*>(&value);
+#endif
+}
+
+template <typename T>
+inline void DoNotOptimize(const T& value){
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "m"(value) : "memory");
+#else
+    static volatile char sink;
+    sink = *reinterpret_cast<const volatile char*>(&value);
+#endif
+}
+
+
+/**
+ @version 1.0
+
+ * Handed to every benchmark. Put the code being timed in a for (auto _ : state) loop; setup before it isn't timed.
+ */
+class State {
+    size_t iterations;
+
+public:
+    State(size_t count) : iterations { count } {
+
+    }
+
+    struct Iterator {
+        size_t left;
+
+        bool operator!=(const Iterator&) const {
+            return left != 0;
+        }
+
+        void operator++(){
+            left --;
+        }
+
+        int operator*() const {
+            return 0;
+        }
+    };
+
+    Iterator begin(){
+        return { iterations };
+    }
+
+    Iterator end(){
+        return { 0 };
+    }
+
+    size_t Iterations() const {
+        return iterations;
+    }
+};
+
+
+struct Benchmark {
+    const char* name;
+    void (*fun)(State&);
+};
+
+inline std::vector<Benchmark>& registry(){
+    static std::vector<Benchmark> benchmarks;
+    return benchmarks;
+}
+
+struct Registrar {
+    Registrar(const char* name, void (*fun)(State&)){
+        registry().push_back({ name, fun });
+    }
+};
+
+
+struct Result {
+    const char* name;
+    size_t iterations;
+    double realNs; // Per iteration
+    double cpuNs;
+};
+
+
+/**
+ * Time one benchmark: run it with more and more iterations until a run takes at least minTime seconds, then report that run.
+ */
+inline Result Measure(const Benchmark& b, double minTime){
+    size_t iterations = 1;
+    while (true){
+        State state { iterations };
+        std::clock_t cpuStart = std::clock();
+        auto start = std::chrono::steady_clock::now();
+        b.fun(state);
+        double real = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double cpu = (double)(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+        if (real >= minTime || iterations >= 1000000000){
+            return { b.name, iterations, real * 1e9 / iterations, cpu * 1e9 / iterations };
+        }
+        double grow = real > 0 ? minTime * 1.4 / real : 10; // Aim a bit past minTime, but never grow more than 10x at once
+        iterations = (size_t)(iterations * (grow > 10 ? 10 : (grow < 2 ? 2 : grow)));
+    }
+}
+
+
+inline void WriteJSON(FILE* out, const char* executable, const std::vector<Result>& results){
+    char date[64];
+    std::time_t now = std::time(0);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+    fprintf(out, "{\n  \"context\": {\n");
+    fprintf(out, "    \"date\": \"%s\",\n", date);
+    fprintf(out, "    \"executable\": \"%s\",\n", executable);
+    fprintf(out, "    \"num_cpus\": %u,\n", std::thread::hardware_concurrency());
+    fprintf(out, "    \"mhz_per_cpu\": 0,\n    \"cpu_scaling_enabled\": false,\n    \"caches\": [],\n");
+#ifdef NDEBUG
+    fprintf(out, "    \"library_build_type\": \"release\"\n");
+#else
+    fprintf(out, "    \"library_build_type\": \"debug\"\n");
+#endif
+    fprintf(out, "  },\n  \"benchmarks\": [\n");
+    for (size_t i = 0; i < results.size(); i ++){
+        const Result& r = results[i];
+        fprintf(out, "    {\n");
+        fprintf(out, "      \"name\": \"%s\",\n      \"run_name\": \"%s\",\n      \"run_type\": \"iteration\",\n", r.name, r.name);
+        fprintf(out, "      \"repetitions\": 1,\n      \"repetition_index\": 0,\n      \"threads\": 1,\n");
+        fprintf(out, "      \"iterations\": %zu,\n      \"real_time\": %.4f,\n      \"cpu_time\": %.4f,\n      \"time_unit\": \"ns\"\n", r.iterations, r.realNs, r.cpuNs);
+        fprintf(out, "    }%s\n", i + 1 < results.size() ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+}
+
+
+/**
+ * Run every registered benchmark. Takes Google Benchmark's flags:
+ * --benchmark_filter=<regex>, --benchmark_min_time=<seconds>, --benchmark_format=<console|json>, --benchmark_out=<file> (always JSON)
+ */
+inline int RunAll(int argc, char** argv){
+    std::string filter = ".";
+    double minTime = 0.5;
+    std::string format = "console";
+    std::string outFile;
+    for (int i = 1; i < argc; i ++){
+        std::string arg = argv[i];
+        auto value = [&](const char* flag){
+            return arg.substr(strlen(flag));
+        };
+        if (arg.rfind("--benchmark_filter=", 0) == 0){
+            filter = value("--benchmark_filter=");
+        }
+        else if (arg.rfind("--benchmark_min_time=", 0) == 0){
+            minTime = std::stod(value("--benchmark_min_time="));
+        }
+        else if (arg.rfind("--benchmark_format=", 0) == 0){
+            format = value("--benchmark_format=");
+        }
+        else if (arg.rfind("--benchmark_out=", 0) == 0){
+            outFile = value("--benchmark_out=");
+        }
+        else {
+            fprintf(stderr, "Unknown flag %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    std::regex match { filter };
+    std::vector<Result> results;
+    bool console = format != "json";
+    if (console){
+        printf("%-40s %15s %15s %12s\n", "Benchmark", "Time", "CPU", "Iterations");
+    }
+    for (const Benchmark& b : registry()){
+        if (!std::regex_search(b.name, match)){
+            continue;
+        }
+        Result r = Measure(b, minTime);
+        results.push_back(r);
+        if (console){
+            printf("%-40s %12.1f ns %12.1f ns %12zu\n", r.name, r.realNs, r.cpuNs, r.iterations);
+        }
+    }
+    if (!console){
+        WriteJSON(stdout, argv[0], results);
+    }
+    if (!outFile.empty()){
+        FILE* out = fopen(outFile.c_str(), "w");
+        if (!out){
+            fprintf(stderr, "Can't write %s\n", outFile.c_str());
+            return 1;
+        }
+        WriteJSON(out, argv[0], results);
+        fclose(out);
+    }
+    return 0;
+}
+
+}
+
+
+#define BENCHMARK_CONCAT2(a, b) a##b
+#define BENCHMARK_CONCAT(a, b) BENCHMARK_CONCAT2(a, b)
+
+/**
+ * Register a benchmark function, void name(benchmark::State&)
+ */
+#define BENCHMARK(fun) static benchmark::Registrar BENCHMARK_CONCAT(_benchmark_, __LINE__) { #fun, fun }
@@ -0,0 +1,130 @@
+/* Replacement global operator new for debug builds, for AllocationGuard.
+    Compiled out entirely unless FRL_ALLOCATION_GUARD is defined.
+*/
+
+#ifdef FRL_ALLOCATION_GUARD
+
+#include <FRL/util/AllocationGuard.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+
+static inline void checkAllocation(std::size_t size, void* caller){
+    if (!AllocationGuard::Armed()){
+        return;
+    }
+    int depth = AllocationGuard::depth;
+    AllocationGuard::depth = 0; // Printing might allocate; don't come back in here if it does
+    fprintf(stderr, "ALLOCATION IN CONTROL LOOP: %zu bytes, called from %p (addr2line it)\n", size, caller);
+    if (AllocationGuard::Fatal){
+        abort();
+    }
+    AllocationGuard::depth = depth;
+}
+
+static inline void* allocate(std::size_t size){
+    void* ret = malloc(size ? size : 1);
+    if (!ret){
+        throw std::bad_alloc {};
+    }
+    return ret;
+}
+
+static inline void* allocateAligned(std::size_t size, std::align_val_t align){
+    std::size_t alignment = (std::size_t)align;
+    size = (size ? size + alignment - 1 : alignment) / alignment * alignment; // aligned_alloc wants a whole number of alignments
+    return aligned_alloc(alignment, size);
+}
+
+
+void* operator new(std::size_t size){
+    checkAllocation(size, __builtin_return_address(0));
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size){
+    checkAllocation(size, __builtin_return_address(0));
+    return allocate(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    checkAllocation(size, __builtin_return_address(0));
+    return malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    checkAllocation(size, __builtin_return_address(0));
+    return malloc(size ? size : 1);
+}
+
+// Over-aligned types (alignas bigger than 16) come through these instead, so they need the same check
+void* operator new(std::size_t size, std::align_val_t align){
+    checkAllocation(size, __builtin_return_address(0));
+    void* ret = allocateAligned(size, align);
+    if (!ret){
+        throw std::bad_alloc {};
+    }
+    return ret;
+}
+
+void* operator new[](std::size_t size, std::align_val_t align){
+    checkAllocation(size, __builtin_return_address(0));
+    void* ret = allocateAligned(size, align);
+    if (!ret){
+        throw std::bad_alloc {};
+    }
+    return ret;
+}
+
+void* operator new(std::size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+    checkAllocation(size, __builtin_return_address(0));
+    return allocateAligned(size, align);
+}
+
+void* operator new[](std::size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+    checkAllocation(size, __builtin_return_address(0));
+    return allocateAligned(size, align);
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept { // aligned_alloc's memory goes back through free like the rest
+    free(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept {
+    free(ptr);
+}
+
+#endif
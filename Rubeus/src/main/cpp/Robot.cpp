@@ -20,47 +20,28 @@
 #include <FRL/util/vector.hpp>
 
 #include "controls.hpp"
+#include "controlmap.h"
 #include "Positionizer.hpp"
 #include "apriltags.h"
+#include <FRL/util/SensorThread.hpp>
+#include <FRL/util/AllocationGuard.hpp>
+#include <FRL/motor/HealthMonitor.hpp>
+#include <FRL/motor/PowerManager.hpp>
+#include <frc/RobotController.h>
+#include <frc/Filesystem.h>
 
 const vector blue_mid_ramp {12.8, -1.9};
 
-SwerveModule frontLeftSwerve (
-	new SparkMotor(FRONT_LEFT_SPEED),
-	new SparkMotor(FRONT_LEFT_DIREC), 
-	FRONT_LEFT_CANCODER,
-	1, 
-	-1024 + FRONT_LEFT_OFFSET
-);
-
-SwerveModule frontRightSwerve (
-	new SparkMotor(FRONT_RIGHT_SPEED),
-	new SparkMotor(FRONT_RIGHT_DIREC),
-	FRONT_RIGHT_CANCODER,
-	2, 
-	1024 + FRONT_RIGHT_OFFSET
-);
+// All of this lives in static storage, built from the description in constants.h. (Threads, the camera and NetworkTables still allocate; the control path doesn't - see AllocationGuard.)
+SwerveModule <SparkMotor, SparkMotor> frontLeftSwerve { hardware.frontLeft };
+SwerveModule <SparkMotor, SparkMotor> frontRightSwerve { hardware.frontRight };
+SwerveModule <SparkMotor, SparkMotor> mainSwerve { hardware.backLeft };
+SwerveModule <SparkMotor, SparkMotor> backRightSwerve { hardware.backRight };
 
-SwerveModule mainSwerve (
-	new SparkMotor(BACK_LEFT_SPEED),
-	new SparkMotor(BACK_LEFT_DIREC),
-	BACK_LEFT_CANCODER,
-	4, 
-	1024 + BACK_LEFT_OFFSET
-);
-
-SwerveModule backRightSwerve (
-	new SparkMotor(BACK_RIGHT_SPEED),
-	new SparkMotor(BACK_RIGHT_DIREC),
-	BACK_RIGHT_CANCODER,
-	3, 
-	-1024 + BACK_RIGHT_OFFSET
-);
-
-Arm <1, 0, 2, 1, 0> arm {
-	new SparkMotor(ARM_SHOULDER),
-	new SparkMotor(ARM_ELBOW),
-	new SparkMotor(ARM_HAND)
+Arm <SparkMotor, 1, 0, 2, 1, 0> arm {
+	hardware.arm.shoulderID,
+	hardware.arm.elbowID,
+	hardware.arm.handID
 };
 
 frc::DoubleSolenoid armSol { frc::PneumaticsModuleType::CTREPCM, 0, 1 };
@@ -69,13 +50,136 @@ AHRS navx {frc::SPI::Port::kMXP}; // Well, obviously, the navx
 double navxOffset = 0;
 
 
-Odometry <NUM_APRILTAGS, apriltags, &navx> odometry ("OV5647"); /* This is what we call misusing templates and doing a bad job of it */
+Odometry <fieldMap, &navx, &mainSwerve> odometry ("OV5647", hardware.swerveVelocityToMPS); /* This is what we call misusing templates and doing a bad job of it */
 frc::Compressor compressor {frc::PneumaticsModuleType::CTREPCM};
 
-Controls <5, 4, 3> controls;
+/* Expected CAN bus load, worked out by the compiler from what each subsystem says it reads (see FRL/motor/StatusFrames.hpp).
+   Printed at boot; the static_assert stops a build that would swamp the bus before it ever gets deployed. */
+constexpr double plannedCANLoad = CANBusLoad(
+    4 * SparkMotor::PlanStatusFrames(decltype(mainSwerve)::SpeedStatus).FramesPerSecond()
+    + SparkMotor::PlanStatusFrames(decltype(mainSwerve)::DirectionStatusFor(hardware.frontLeft)).FramesPerSecond()
+    + SparkMotor::PlanStatusFrames(decltype(mainSwerve)::DirectionStatusFor(hardware.frontRight)).FramesPerSecond()
+    + SparkMotor::PlanStatusFrames(decltype(mainSwerve)::DirectionStatusFor(hardware.backLeft)).FramesPerSecond()
+    + SparkMotor::PlanStatusFrames(decltype(mainSwerve)::DirectionStatusFor(hardware.backRight)).FramesPerSecond()
+    + 4 * decltype(mainSwerve)::CANCoderFramesPerSecond
+    + 2 * SparkMotor::PlanStatusFrames(decltype(arm)::JointStatus).FramesPerSecond()
+    + SparkMotor::PlanStatusFrames(decltype(arm)::HandStatus).FramesPerSecond()
+    + 11 * 1000.0 / LOOP_PERIOD_MS // Setpoints going out: one per motor per tick
+    + 200 // PDP and PCM status; we don't get a say in those
+);
+static_assert(plannedCANLoad < 0.6, "Planned CAN bus load is over 60%; slow some status frames down");
+
+Controls <xboxMap, joystickMap, buttonboardMap> controls; // Later devices win ties, so the buttonboard has the final say
+
+/* Everything the control loop reads off the hardware, as one timestamped snapshot.
+   The sensor thread fills these in on its own schedule; the control loop just grabs the newest one and never waits on a driver. */
+struct SensorFrame {
+	double time;
+	SwerveModuleReadings frontLeft;
+	SwerveModuleReadings frontRight;
+	SwerveModuleReadings backLeft;
+	SwerveModuleReadings backRight;
+	ArmReadings arm;
+	double navxHeading; // Fused, degrees, before navxOffset
+	double navxRoll;
+	double batteryVoltage;
+	double compressorCurrent;
+	bool compressorWantsAir; // Pressure switch says the tanks aren't full
+};
+
+void readSensors(SensorFrame& frame){ // Sensor thread! Hardware reads only.
+	frame.frontLeft = frontLeftSwerve.Sense();
+	frame.frontRight = frontRightSwerve.Sense();
+	frame.backLeft = mainSwerve.Sense();
+	frame.backRight = backRightSwerve.Sense();
+	frame.arm = arm.Sense();
+	frame.navxHeading = navx.GetFusedHeading();
+	frame.navxRoll = navx.GetRoll();
+	frame.batteryVoltage = frc::RobotController::GetInputVoltage();
+	frame.compressorCurrent = compressor.GetCurrent().value();
+	frame.compressorWantsAir = compressor.GetPressureSwitchValue();
+}
+
+SensorThread <SensorFrame, readSensors> sensors { std::chrono::milliseconds(5) };
+SensorFrame sensed; // This tick's snapshot
+
+enum Motors { // Indices into health
+	FRONT_LEFT_SPEED, FRONT_LEFT_DIREC,
+	FRONT_RIGHT_SPEED, FRONT_RIGHT_DIREC,
+	BACK_LEFT_SPEED, BACK_LEFT_DIREC,
+	BACK_RIGHT_SPEED, BACK_RIGHT_DIREC,
+	ARM_SHOULDER, ARM_ELBOW, ARM_HAND,
+	MOTOR_COUNT
+};
+
+HealthMonitor <MOTOR_COUNT> health; // Every motor's current history and heat. NEO limits unless main says otherwise
+
+enum PowerConsumers { // Indices into power, most important first: driving beats the arm beats air
+	POWER_DRIVE,
+	POWER_ARM,
+	POWER_COMPRESSOR,
+	POWER_CONSUMER_COUNT
+};
+
+PowerManager <POWER_CONSUMER_COUNT> power; // Shares out what the battery can give without browning out
+constexpr double COMPRESSOR_CURRENT = 12; // Roughly what the compressor pulls when it runs
+bool compressorAllowed = false; // Teleop wants air; the power manager decides when
+bool compressorRunning = false;
+
+void useSensors(){ // First thing every tick, alongside controls.update()
+	double lastTime = sensed.time;
+	sensed = sensors.Read();
+	frontLeftSwerve.Use(sensed.frontLeft);
+	frontRightSwerve.Use(sensed.frontRight);
+	mainSwerve.Use(sensed.backLeft);
+	backRightSwerve.Use(sensed.backRight);
+	arm.Use(sensed.arm);
+	odometry.Use(sensed.navxHeading, sensed.time);
+
+	const double currents[MOTOR_COUNT] = {
+		sensed.frontLeft.speedCurrent, sensed.frontLeft.directionCurrent,
+		sensed.frontRight.speedCurrent, sensed.frontRight.directionCurrent,
+		sensed.backLeft.speedCurrent, sensed.backLeft.directionCurrent,
+		sensed.backRight.speedCurrent, sensed.backRight.directionCurrent,
+		sensed.arm.shoulderCurrent, sensed.arm.elbowCurrent, sensed.arm.handCurrent
+	};
+	double dt = lastTime > 0 ? sensed.time - lastTime : 0;
+	health.Record(currents, dt);
+
+	double measured = sensed.compressorCurrent;
+	for (double current : currents){
+		measured += current;
+	}
+	double voltage = sensed.batteryVoltage;
+	const double demand[POWER_CONSUMER_COUNT] = {
+		frontLeftSwerve.Demand(voltage) + frontRightSwerve.Demand(voltage) + mainSwerve.Demand(voltage) + backRightSwerve.Demand(voltage),
+		arm.Demand(),
+		sensed.compressorWantsAir ? std::max(sensed.compressorCurrent, COMPRESSOR_CURRENT) : 0
+	};
+	power.Update(voltage, measured, demand, dt);
+
+	double drive = power.Scale(POWER_DRIVE);
+	double arming = power.Scale(POWER_ARM);
+	frontLeftSwerve.SetOutputScale(health.Derate(FRONT_LEFT_SPEED) * drive, health.Derate(FRONT_LEFT_DIREC) * drive);
+	frontRightSwerve.SetOutputScale(health.Derate(FRONT_RIGHT_SPEED) * drive, health.Derate(FRONT_RIGHT_DIREC) * drive);
+	mainSwerve.SetOutputScale(health.Derate(BACK_LEFT_SPEED) * drive, health.Derate(BACK_LEFT_DIREC) * drive);
+	backRightSwerve.SetOutputScale(health.Derate(BACK_RIGHT_SPEED) * drive, health.Derate(BACK_RIGHT_DIREC) * drive);
+	arm.SetOutputScale(health.Derate(ARM_SHOULDER) * arming, health.Derate(ARM_ELBOW) * arming, health.Derate(ARM_HAND) * arming);
+
+	bool runCompressor = compressorAllowed && power.Scale(POWER_COMPRESSOR) >= 1; // It's on or off; no half measures
+	if (runCompressor != compressorRunning){
+		if (runCompressor){
+			compressor.EnableDigital();
+		}
+		else {
+			compressor.Disable();
+		}
+		compressorRunning = runCompressor;
+	}
+}
 
 long navxHeading(){
-	return navx.GetFusedHeading() - navxOffset;
+	return sensed.navxHeading - navxOffset;
 }
 
 long navxHeadingToEncoderTicks(){
@@ -83,7 +187,8 @@ long navxHeadingToEncoderTicks(){
 }
 
 void zeroNavx(){
-	navxOffset = navx.GetFusedHeading();
+	navxOffset = sensors.Read().navxHeading; // Not sensed: this gets called from Start(), before the first tick
+	odometry.SetHeadingOffset(navxOffset);
 }
 
 bool onRamp = false;
@@ -95,13 +200,13 @@ void autoRamp() {
         frc::SmartDashboard::PutNumber("Navx heading", navxHeadingToEncoderTicks());
         approachethAngle = smartLoop(navxHeadingToEncoderTicks() + -180, 360);
         mainSwerve.SetPercent(.27);
-        if (navx.GetRoll() * -1 > 10) {
+        if (sensed.navxRoll * -1 > 10) {
             onRamp = true;
         }
     }
     else {
         mainSwerve.SetDirection(90 * (4096/360));
-        float speed = navx.GetRoll() * -1 * .017;
+        float speed = sensed.navxRoll * -1 * .017;
         frc::SmartDashboard::PutNumber("Ramp Load Speed", speed);
         mainSwerve.SetPercent(speed);
     }
@@ -205,7 +310,7 @@ public:
 
 	void Start(){
 		zeroNavx();
-        compressor.EnableDigital();
+        compressorAllowed = true; // useSensors turns it on when there's power to spare
         macros = autoMacro;
 	}
 
@@ -213,6 +318,8 @@ public:
     MacroController macros {true};
 
     void armAux(){ // Arm auxiliary mode
+        controls.update();
+        useSensors();
         if (controls.GetButton(ELBOW_CONTROL)){
             arm.AuxSetPercent(0, controls.LeftY());//g.x += controls.LeftY() * 5;
         }
@@ -224,15 +331,24 @@ public:
         }
         arm.test();
         arm.checkSwitches(); // Always check switches. Friggin' always.
-        controls.update();
     }
 
 	void Synchronous(){
+		Position2D pos;
+		{
+			AllocationGuard guard; // Debug builds: reading the controls through to commanding the motors must not allocate
+			pos = control();
+		}
+		telemetry(pos); // Outside the guard: NetworkTables allocates (a new key's first Put, at least)
+	}
+
+	/**
+	 * Everything from reading the controls to commanding the motors. No dashboard in here; that's telemetry's job.
+	 */
+	Position2D control(){
+		controls.update(); // First thing, so everything this tick acts on fresh inputs
+		useSensors();
 		Position2D pos = odometry.Update();
-		frc::SmartDashboard::PutNumber("Odometry nearest angle", odometry.NearestAngle() * 180/PI);
-		frc::SmartDashboard::PutNumber("Odometry X", pos.x);
-		frc::SmartDashboard::PutNumber("Odometry Y", pos.y);
-		frc::SmartDashboard::PutNumber("Odometry Quality", odometry.Quality());
         /*if (owner != 0){
             if (!owner -> Execute()){
                 owner = 0;
@@ -244,7 +360,6 @@ public:
 		rotation.setMandA(controls.RightX(), PI/4);
 
 		float limit = controls.GetSpeedLimit();
-		frc::SmartDashboard::PutNumber("Speed limit", limit);
 
 		rotation.dead(0.2);
 		translation.dead(0.12);
@@ -292,8 +407,6 @@ public:
             arm.Zero();
         }
 
-        frc::SmartDashboard::PutNumber("Maura is a WOMAN", controls.GetOption());
-
         if (controls.GetButton(ARM_PICKUP)) { // like a woman, this code doesn't work
             arm.goToPickup();
             arm.SetGrab(INTAKE);
@@ -307,10 +420,24 @@ public:
         else {
             arm.goToHome();
         }
-        arm.test();
 		// Should run periodically no matter what - it cleans up after itself
         mainSwerve.ApplySpeed();
-        controls.update();
+		return pos;
+	}
+
+	void telemetry(const Position2D& pos){
+		frc::SmartDashboard::PutNumber("Controls read to motor command ms", controls.Age() * 1000); // Our end only; DS packet latency isn't in it
+		frc::SmartDashboard::PutNumber("Odometry nearest angle", odometry.NearestAngle() * 180/PI);
+		frc::SmartDashboard::PutNumber("Odometry X", pos.x);
+		frc::SmartDashboard::PutNumber("Odometry Y", pos.y);
+		frc::SmartDashboard::PutNumber("Odometry Quality", odometry.Quality());
+		frc::SmartDashboard::PutNumber("Odometry StdDev", odometry.StdDev());
+		frc::SmartDashboard::PutNumber("Tags used", odometry.TagsUsed());
+		frc::SmartDashboard::PutNumber("Power budget", power.Budget());
+		frc::SmartDashboard::PutNumber("Drive power scale", power.Scale(POWER_DRIVE));
+		frc::SmartDashboard::PutNumber("Speed limit", controls.GetSpeedLimit());
+		frc::SmartDashboard::PutNumber("Maura is a WOMAN", controls.GetOption());
+        arm.test();
 	}
 };
 
@@ -335,6 +462,8 @@ public:
     vector goal;
 
 	void Synchronous(){
+        AllocationGuard guard; // Debug builds: no allocating between the sensors and the motors. There's no telemetry here to get in the way
+        useSensors();
         goal = {1, 0};
         auto pos = odometry.Update();
         translation = { pos.y - goal.y, pos.x - goal.x };
@@ -366,6 +495,12 @@ int main() {
 	mainSwerve.Link(&backRightSwerve); // Weird, right? This can in fact be used here.
 	backRightSwerve.Link(&frontRightSwerve);
 	frontRightSwerve.Link(&frontLeftSwerve);
+	std::cout << "Planned CAN bus load: " << plannedCANLoad * 100 << "%" << std::endl;
+	health.SetConstants(ARM_HAND, NEO550_THERMAL); // The hand's a 550; it cooks a lot sooner than the NEOs
+	arm.UseSensorThread(); // Before it starts: the sensor thread owns the arm's encoder filters
+	sensors.Start();
+	odometry.Start(); // Spin up the vision thread now, so the control loop never has to
+	arm.map.Load(frc::filesystem::GetDeployDirectory() + "/" + ArmMap::File);
 	mainSwerve.SetLockTime(1); // Time before the swerve drive locks, in seconds
 	// As it turns out, int main actually still exists and even works here in FRC. I'm tempted to boil it down further and get rid of that stupid StartRobot function (replace it with something custom inside AwesomeRobot).
 	return frc::StartRobot<AwesomeRobot<TeleopMode, AutonomousMode, TestMode, DisabledMode>>(); // Look, the standard library does these nested templates more than I do.
@@ -0,0 +1,90 @@
+/* Arm dynamics.
+    A two-link model of the arm: how much torque each joint needs to hold a position against gravity and to follow a motion, and what motor output that takes.
+    The arm uses it as feedforward, so its PID loops only have to fix what the model gets wrong.
+*/
+
+#pragma once
+
+#include <cmath>
+#include "ArmKinematics.hpp"
+#include "ArmTrajectory.hpp"
+#include <FRL/motor/PowerManager.hpp>
+
+
+/**
+ @version 1.0
+
+ * Masses, gearing and motors for ArmDynamics. Each bar is taken as a uniform rod; the game piece as a point at the head.
+ * Tune by altering them directly, same as PIDConstants. Weigh the bars!
+ */
+struct ArmDynamicsConstants {
+    double shoulderBarMass = 1.5; // kg
+    double elbowBarMass = 1.5; // kg, with the hand
+    double payloadMass = 0.65; // kg, a cone; only counted while the arm Has() something
+    double ratio[2] = { 100, 100 }; // Motor rotations per joint rotation, shoulder and elbow
+    DCMotor motor {}; // Both joints are NEOs
+    double voltage = 12; // What output 1 is taken to mean. Nominal; brownout derating happens elsewhere (PowerManager)
+    double friction[2] = { 0.01, 0.01 }; // Output it takes to get each joint moving at all
+    double maxOutput = 0.1; // The most feedforward either joint gets, whatever the model says. It goes on after the PID's clamp, so keep it small until the masses and ratio above are measured
+};
+
+
+/**
+ * Torque at each joint, Nm. Shoulder positive lifts the shoulder bar; elbow positive opens the elbow (same directions as ArmJoints).
+ */
+struct ArmTorques {
+    double shoulder;
+    double elbow;
+};
+
+
+constexpr double standardGravity = 9.81; // m/s²
+
+/**
+ * Torque each joint needs to be at sample's position, velocity and acceleration: the standard two-link rigid-body equations
+ * (inertia, Coriolis and centripetal, gravity), with the elbow bar and payload lumped together as one link.
+ @param holding Whether the hand has a game piece in it
+ */
+constexpr ArmTorques ArmInverseDynamics(const ArmSample& sample, const ArmDynamicsConstants& constants, bool holding = false){
+    double l1 = shoulderBarLengthCM / 100; // m
+    double l2 = elbowBarLengthCM / 100;
+    double m1 = constants.shoulderBarMass;
+    double payload = holding ? constants.payloadMass : 0;
+    double m2 = constants.elbowBarMass + payload;
+    double first1 = m1 * l1 / 2; // First moment of the shoulder bar about the shoulder, kg m
+    double first2 = constants.elbowBarMass * l2 / 2 + payload * l2; // Of the elbow link about the elbow
+    double second1 = m1 * l1 * l1 / 3; // Moments of inertia, kg m², about each link's own joint
+    double second2 = constants.elbowBarMass * l2 * l2 / 3 + payload * l2 * l2;
+
+    double s = sample.position.shoulder;
+    double e = sample.position.elbow;
+    double cosE = cexpr::cos(e);
+    double coupling = l1 * first2 * cosE;
+    double h = l1 * first2 * cexpr::sin(e);
+    double ws = sample.velocity.shoulder;
+    double we = sample.velocity.elbow;
+    double as = sample.acceleration.shoulder;
+    double ae = sample.acceleration.elbow;
+
+    double elbowGravity = standardGravity * first2 * cexpr::cos(s + e);
+    return {
+        (second1 + second2 + m2 * l1 * l1 + 2 * coupling) * as + (second2 + coupling) * ae - h * (2 * ws * we + we * we)
+            + standardGravity * (first1 + m2 * l1) * cexpr::cos(s) + elbowGravity,
+        (second2 + coupling) * as + second2 * ae + h * ws * ws + elbowGravity
+    };
+}
+
+/**
+ * Motor output (-1 to 1) for one joint to make some torque while turning at some speed: the current for the torque through the windings, plus the back EMF, plus friction.
+ @param joint 0 for the shoulder, 1 for the elbow
+ @param torque Nm at the joint
+ @param velocity rad/s at the joint
+ */
+constexpr double ArmJointOutput(int joint, double torque, double velocity, const ArmDynamicsConstants& constants){
+    double kt = 60 / (2 * cexpr::pi * constants.motor.Kv); // Nm per amp
+    double current = torque / constants.ratio[joint] / kt;
+    double rpm = velocity * constants.ratio[joint] * 60 / (2 * cexpr::pi);
+    double ret = (current * constants.motor.Resistance + rpm / constants.motor.Kv) / constants.voltage;
+    ret += velocity > 0 ? constants.friction[joint] : (velocity < 0 ? -constants.friction[joint] : 0);
+    return ret > constants.maxOutput ? constants.maxOutput : (ret < -constants.maxOutput ? -constants.maxOutput : ret);
+}
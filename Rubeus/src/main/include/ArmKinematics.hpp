@@ -0,0 +1,64 @@
+/* Arm kinematics, in radians.
+    Closed-form inverse and forward kinematics for the two-bar arm: one atan2 per joint for IK and one sin/cos pair per bar for FK.
+    No degree conversions, no loops, and all of it constexpr, so fixed positions can be solved at compile time.
+*/
+
+#pragma once
+
+#include <FRL/util/ConstexprMath.hpp>
+#include <FRL/util/vector.hpp>
+
+constexpr double shoulderBarLengthCM = 91.44; // Length of the forearm in centimeters
+constexpr double elbowBarLengthCM = 91.44; // What can I call it? Anti-forearm? Arm? Elbow-y bit? Yeah. Elbow-y bit. This is the elbow-y bit length in centimeters.
+
+
+/**
+ * Where the two bars point, in radians counterclockwise from horizontal. The elbow angle is absolute (from horizontal), not relative to the shoulder bar.
+ */
+struct JointAngles {
+    double shoulder;
+    double elbow;
+    bool reachable; // False if the goal was out of reach; the angles are then for the nearest point that isn't
+};
+
+
+/**
+ * Joint angles that put the head at a point, elbow up (the shoulder bar above the line to the goal, same as the arm has always run).
+
+ * Law of cosines on the triangle of the two bars and the line from the shoulder to the goal gives the triangle's angle at the shoulder.
+ * Rotating the goal direction up by that angle (as a cos/sin pair, no trig) points along the shoulder bar, and the elbow bar points from the end of that to the goal.
+ * That's one atan2 per joint (atan2Fast, which is plenty accurate for 4096-tick encoders) and nothing else transcendental. The cosine is clamped rather than branched on, so an out of reach goal just gets the arm stretched towards it.
+ @param x Head position forward of the shoulder pivot, cm
+ @param y Head position above the shoulder pivot, cm
+ */
+constexpr JointAngles ArmIK(double x, double y){
+    constexpr double L1 = shoulderBarLengthCM;
+    constexpr double L2 = elbowBarLengthCM;
+    double d2 = x * x + y * y;
+    double d = cexpr::sqrt(d2);
+    double k = 1 / (d > 1e-9 ? d : 1e-9); // The only division
+    double c = (L1 * L1 - L2 * L2 + d2) * k * (1 / (2 * L1)); // Cosine of the angle between the shoulder bar and the goal line
+    bool reachable = c >= -1 && c <= 1;
+    c = c < -1 ? -1 : (c > 1 ? 1 : c);
+    double s = cexpr::sqrt(1 - c * c);
+    double ux = (x * c - y * s) * k; // Along the shoulder bar
+    double uy = (x * s + y * c) * k;
+    return {
+        cexpr::atan2Fast(uy, ux),
+        cexpr::atan2Fast(y - L1 * uy, x - L1 * ux),
+        reachable
+    };
+}
+
+
+/**
+ * Head position for some joint angles, cm from the shoulder pivot
+ @param shoulder Shoulder bar angle, radians from horizontal
+ @param elbow Elbow bar angle, radians from horizontal
+ */
+constexpr vector ArmFK(double shoulder, double elbow){
+    return {
+        shoulderBarLengthCM * cexpr::cos(shoulder) + elbowBarLengthCM * cexpr::cos(elbow),
+        shoulderBarLengthCM * cexpr::sin(shoulder) + elbowBarLengthCM * cexpr::sin(elbow)
+    };
+}
@@ -0,0 +1,227 @@
+/* Arm configuration-space map.
+    A bitmap over the arm's joint space saying which positions it can actually be in (inside the joint limits, out of every obstacle).
+    Built off the robot by the armMap tool (src/armmap) and deployed as armmap.bin; the robot memory-maps it at startup, so checking a goal is one IK and one bit.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "ArmTrajectory.hpp"
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+/**
+ * What's at the front of armmap.bin. The bits follow straight after: Size * Size of them, a row of elbow cells for each shoulder cell, low bit first.
+ */
+struct ArmMapHeader {
+    char magic[4]; // "ARMM"
+    uint32_t size; // Cells along each joint
+    double shoulderMin; // Radians, the low edge of the first cell. Same ranges as ArmJoints
+    double elbowMin;
+    double cellSize; // Radians
+    uint64_t constantsHash; // ArmMap::Hash of the ArmPlannerConstants it was built from
+};
+
+
+/**
+ @version 1.0
+
+ * The deployed configuration-space map. Until Load succeeds (no file, or one built from different obstacles or limits) it asks ArmAllowed instead:
+ * same answers, just slower.
+
+ * Usage:
+ * ArmMap map { planner.constants };
+ * map.Load(frc::filesystem::GetDeployDirectory() + "/" + ArmMap::File); // at startup, and again after changing the constants
+ * if (map.Allowed(ToArmJoints(ArmIK(x, y)))) ...
+ */
+class ArmMap {
+    const ArmPlannerConstants& constants;
+    const uint8_t* bits = nullptr;
+    void* mapping = nullptr;
+    size_t mappingLength = 0;
+#ifdef _WIN32
+    std::string buffer; // No mmap; read it in instead
+#endif
+
+    static int cell(double angle, double min){
+        int c = (int)((angle - min) / CellSize);
+        return c < 0 ? 0 : (c >= Size ? Size - 1 : c);
+    }
+
+    bool at(int shoulder, int elbow) const {
+        if (!bits){
+            return ArmAllowed({ ShoulderMin + (shoulder + 0.5) * CellSize, ElbowMin + (elbow + 0.5) * CellSize }, constants);
+        }
+        size_t bit = (size_t)shoulder * Size + elbow;
+        return bits[bit / 8] & (1 << (bit % 8));
+    }
+
+    static void hashIn(uint64_t& hash, double value){
+        uint8_t bytes[sizeof(value)];
+        memcpy(bytes, &value, sizeof(value));
+        for (uint8_t byte : bytes){
+            hash = (hash ^ byte) * 0x100000001b3; // FNV-1a
+        }
+    }
+
+public:
+    static constexpr int Size = 512;
+    static constexpr double ShoulderMin = -cexpr::pi / 2;
+    static constexpr double ElbowMin = -3 * cexpr::pi / 2;
+    static constexpr double CellSize = 2 * cexpr::pi / Size;
+    static constexpr size_t Bytes = (size_t)Size * Size / 8;
+    static constexpr const char* File = "armmap.bin";
+
+    ArmMap(const ArmPlannerConstants& planned) : constants { planned } {
+
+    }
+
+    /**
+     * A fingerprint of everything in the constants that decides where the arm can be: obstacles, joint limits and clearance. Not the speeds.
+     */
+    static uint64_t Hash(const ArmPlannerConstants& c){
+        uint64_t hash = 0xcbf29ce484222325;
+        hashIn(hash, c.obstacleCount);
+        for (int i = 0; i < c.obstacleCount; i ++){
+            hashIn(hash, c.obstacles[i].minX);
+            hashIn(hash, c.obstacles[i].maxX);
+            hashIn(hash, c.obstacles[i].minY);
+            hashIn(hash, c.obstacles[i].maxY);
+        }
+        for (int j = 0; j < 2; j ++){
+            hashIn(hash, c.minJoints[j]);
+            hashIn(hash, c.maxJoints[j]);
+        }
+        hashIn(hash, c.clearance);
+        return hash;
+    }
+
+    ArmMap(const ArmMap&) = delete;
+
+    ~ArmMap(){
+        Unload();
+    }
+
+    /**
+     * Forget the map and go back to checking with ArmAllowed
+     */
+    void Unload(){
+        bits = nullptr;
+#ifdef _WIN32
+        buffer.clear();
+#else
+        if (mapping){
+            munmap(mapping, mappingLength);
+            mapping = nullptr;
+        }
+#endif
+    }
+
+    /**
+     * Map armmap.bin in. Checks it was built for this Size and these ranges, and from the constants as they are now; if it wasn't (or isn't there), the map stays unloaded.
+     @param path Where it is. On the robot, the deploy directory
+     */
+    bool Load(const std::string& path){
+        Unload();
+        const uint8_t* data = nullptr;
+        size_t length = 0;
+#ifdef _WIN32
+        FILE* file = fopen(path.c_str(), "rb");
+        if (file){
+            char chunk[4096];
+            size_t got;
+            while ((got = fread(chunk, 1, sizeof(chunk), file)) > 0){
+                buffer.append(chunk, got);
+            }
+            fclose(file);
+            data = (const uint8_t*)buffer.data();
+            length = buffer.size();
+        }
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        struct stat info;
+        if (fd >= 0 && fstat(fd, &info) == 0 && info.st_size > 0){
+            void* m = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (m != MAP_FAILED){
+                mapping = m;
+                mappingLength = info.st_size;
+                data = (const uint8_t*)m;
+                length = info.st_size;
+            }
+        }
+        if (fd >= 0){
+            close(fd); // The mapping stays good without it
+        }
+#endif
+        ArmMapHeader header;
+        if (!data || length != sizeof(header) + Bytes){
+            printf("Arm map: couldn't load %s\n", path.c_str());
+            return false;
+        }
+        memcpy(&header, data, sizeof(header));
+        if (memcmp(header.magic, "ARMM", 4) != 0 || header.size != Size || header.shoulderMin != ShoulderMin || header.elbowMin != ElbowMin || header.cellSize != CellSize){
+            printf("Arm map: %s is for a different grid; rebuild it with the armMap tool\n", path.c_str());
+            return false;
+        }
+        if (header.constantsHash != Hash(constants)){
+            printf("Arm map: %s was built for different obstacles or joint limits; rebuild it with the armMap tool. Checking without it\n", path.c_str());
+            return false;
+        }
+        bits = data + sizeof(header);
+        return true;
+    }
+
+    bool Loaded() const {
+        return bits != nullptr;
+    }
+
+    /**
+     * Whether the arm can be at a joint position. Without a map, straight from ArmAllowed.
+     */
+    bool Allowed(const ArmJoints& joints) const {
+        return bits ? at(cell(joints.shoulder, ShoulderMin), cell(joints.elbow, ElbowMin)) : ArmAllowed(joints, constants);
+    }
+
+    /**
+     * Move a joint position to the nearest allowed one, looking outwards in square rings of cells.
+     @param joints Where to start, replaced with the center of the nearest allowed cell (or left alone if it's already allowed)
+     @param radius How many cells out to look
+     @returns false if there's nothing allowed within radius
+     */
+    bool Nearest(ArmJoints& joints, int radius = 16) const {
+        if (Allowed(joints)){
+            return true;
+        }
+        int s = cell(joints.shoulder, ShoulderMin);
+        int e = cell(joints.elbow, ElbowMin);
+        for (int r = 1; r <= radius; r ++){
+            int best = -1;
+            int bestDistance = 0;
+            for (int ds = -r; ds <= r; ds ++){
+                for (int de = -r; de <= r; de ++){
+                    if ((ds != -r && ds != r && de != -r && de != r) || s + ds < 0 || s + ds >= Size || e + de < 0 || e + de >= Size){
+                        continue; // Only the ring itself; the inside's been looked at
+                    }
+                    int distance = ds * ds + de * de;
+                    if (at(s + ds, e + de) && (best == -1 || distance < bestDistance)){
+                        best = (s + ds) * Size + (e + de);
+                        bestDistance = distance;
+                    }
+                }
+            }
+            if (best != -1){
+                joints = { ShoulderMin + (best / Size + 0.5) * CellSize, ElbowMin + (best % Size + 0.5) * CellSize };
+                return true;
+            }
+        }
+        return false;
+    }
+};
@@ -0,0 +1,556 @@
+/* Arm trajectory planning.
+    Plans joint-space moves that stay out of obstacles (the bumper, the floor, the frame perimeter) and times them as fast as the joint limits allow,
+    with both joints starting and finishing together. Everything lives in fixed arrays: planning never allocates, so it's safe in Synchronous.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include "ArmKinematics.hpp"
+
+
+/**
+ * A point in the arm's joint space, radians: the shoulder bar's angle from horizontal, and the elbow's angle relative to the shoulder bar (what the elbow motor actually turns).
+ * Shoulder is kept in [-pi/2, 3pi/2) and elbow in [-3pi/2, pi/2), so nothing the arm really does crosses a wrap.
+ */
+struct ArmJoints {
+    double shoulder;
+    double elbow;
+};
+
+constexpr ArmJoints ToArmJoints(const JointAngles& angles){
+    return {
+        cexpr::wrap(angles.shoulder + cexpr::pi / 2) - cexpr::pi / 2,
+        cexpr::wrap(angles.elbow - angles.shoulder + 3 * cexpr::pi / 2) - 3 * cexpr::pi / 2
+    };
+}
+
+constexpr JointAngles ToJointAngles(const ArmJoints& joints){
+    return { joints.shoulder, joints.shoulder + joints.elbow, true };
+}
+
+
+/**
+ * Somewhere the arm can't go, as a box in head space: cm from the shoulder pivot, x forward and y up. Neither bar may pass through it.
+ */
+struct ArmBox {
+    double minX;
+    double maxX;
+    double minY;
+    double maxY;
+};
+
+
+/**
+ @version 1.0
+
+ * Limits and obstacles for ArmPlanner. Tune by altering them directly, same as PIDConstants; call ArmPlanner::Rebuild after changing obstacles.
+ * Obstacle positions are measured from the shoulder pivot. Measure them on the robot!
+ */
+struct ArmPlannerConstants {
+    double maxVelocity[2] = { 0.8, 1.2 }; // rad/s, shoulder and elbow. Don't raise these until ArmDynamicsConstants' masses and ratio are measured: the feedforward's capped small until then
+    double maxAcceleration[2] = { 2, 3 }; // rad/s²
+    ArmBox obstacles[8] = {
+        { -1000, 1000, -1000, -40 }, // Floor
+        { 25, 55, -40, -10 }, // Bumper
+        { 160, 1000, -1000, 1000 }, // Extension limit past the frame perimeter
+        { -1000, 1000, 150, 1000 } // Height limit
+    };
+    int obstacleCount = 4;
+    double minJoints[2] = { 0, -165 * cexpr::pi / 180 }; // Shoulder and elbow (ArmJoints), radians. The shoulder's upper limit is its switch (shoulderDefaultAngle in arm.hpp), the elbow's lower is its own
+    double maxJoints[2] = { 82 * cexpr::pi / 180, 0 };
+    double clearance = 5; // cm kept between the arm and every obstacle. Also covers the gaps between the points ArmPlanner checks (1 degree apart, so a few cm at the head)
+};
+
+
+/**
+ * Whether the segment a-b passes through a box (Liang-Barsky clipping)
+ */
+constexpr bool SegmentHitsBox(double ax, double ay, double bx, double by, const ArmBox& box){
+    double t0 = 0;
+    double t1 = 1;
+    double d[2] = { bx - ax, by - ay };
+    double lo[2] = { box.minX - ax, box.minY - ay };
+    double hi[2] = { box.maxX - ax, box.maxY - ay };
+    for (int axis = 0; axis < 2; axis ++){
+        if (d[axis] == 0){
+            if (lo[axis] > 0 || hi[axis] < 0){
+                return false; // Parallel to this slab and outside it
+            }
+            continue;
+        }
+        double ta = lo[axis] / d[axis];
+        double tb = hi[axis] / d[axis];
+        if (ta > tb){
+            double swap = ta;
+            ta = tb;
+            tb = swap;
+        }
+        t0 = ta > t0 ? ta : t0;
+        t1 = tb < t1 ? tb : t1;
+        if (t0 > t1){
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Whether either bar is in an obstacle at some joint position
+ */
+constexpr bool ArmCollides(const ArmJoints& joints, const ArmPlannerConstants& constants){
+    double ex = shoulderBarLengthCM * cexpr::cos(joints.shoulder);
+    double ey = shoulderBarLengthCM * cexpr::sin(joints.shoulder);
+    double hx = ex + elbowBarLengthCM * cexpr::cos(joints.shoulder + joints.elbow);
+    double hy = ey + elbowBarLengthCM * cexpr::sin(joints.shoulder + joints.elbow);
+    for (int i = 0; i < constants.obstacleCount; i ++){
+        const ArmBox& o = constants.obstacles[i];
+        ArmBox box { o.minX - constants.clearance, o.maxX + constants.clearance, o.minY - constants.clearance, o.maxY + constants.clearance };
+        if (SegmentHitsBox(0, 0, ex, ey, box) || SegmentHitsBox(ex, ey, hx, hy, box)){
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Whether the arm can be at some joint position: inside the joint limits and out of every obstacle
+ */
+constexpr bool ArmAllowed(const ArmJoints& joints, const ArmPlannerConstants& constants){
+    if (joints.shoulder < constants.minJoints[0] || joints.shoulder > constants.maxJoints[0] || joints.elbow < constants.minJoints[1] || joints.elbow > constants.maxJoints[1]){
+        return false;
+    }
+    return !ArmCollides(joints, constants);
+}
+
+
+/**
+ * Where the arm should be at some time along a trajectory, and how fast it should be going there
+ */
+struct ArmSample {
+    ArmJoints position;
+    ArmJoints velocity; // rad/s
+    ArmJoints acceleration; // rad/s²
+};
+
+
+/**
+ * One straight line in joint space, rest to rest. Both joints follow the same trapezoidal profile in s (0 to 1 along the line),
+ * with s's velocity and acceleration capped by whichever joint hits its limit first - that's as fast as the line can be done with both joints in sync.
+ */
+struct ArmSegment {
+    ArmJoints start;
+    ArmJoints delta;
+    double accel; // Of s, per second squared
+    double peak; // Top speed of s, per second
+    double accelTime;
+    double cruiseTime;
+    double duration;
+
+    static constexpr ArmSegment Plan(const ArmJoints& from, const ArmJoints& to, const ArmPlannerConstants& constants){
+        ArmSegment ret { from, { to.shoulder - from.shoulder, to.elbow - from.elbow }, 0, 0, 0, 0, 0 };
+        double span[2] = { ret.delta.shoulder < 0 ? -ret.delta.shoulder : ret.delta.shoulder, ret.delta.elbow < 0 ? -ret.delta.elbow : ret.delta.elbow };
+        double velocity = 1e9;
+        double accel = 1e9;
+        for (int j = 0; j < 2; j ++){
+            if (span[j] > 1e-9){
+                velocity = constants.maxVelocity[j] / span[j] < velocity ? constants.maxVelocity[j] / span[j] : velocity;
+                accel = constants.maxAcceleration[j] / span[j] < accel ? constants.maxAcceleration[j] / span[j] : accel;
+            }
+        }
+        if (velocity == 1e9){
+            return ret; // Already there
+        }
+        ret.accel = accel;
+        if (velocity * velocity / accel >= 1){ // Never reaches top speed: accelerate halfway, decelerate the rest
+            ret.accelTime = cexpr::sqrt(1 / accel);
+            ret.peak = accel * ret.accelTime;
+        }
+        else {
+            ret.accelTime = velocity / accel;
+            ret.peak = velocity;
+            ret.cruiseTime = (1 - velocity * ret.accelTime) / velocity;
+        }
+        ret.duration = 2 * ret.accelTime + ret.cruiseTime;
+        return ret;
+    }
+
+    constexpr ArmSample Sample(double t) const {
+        double s, v, a;
+        if (t <= 0){
+            s = 0, v = 0, a = 0;
+        }
+        else if (t < accelTime){
+            s = accel * t * t / 2, v = accel * t, a = accel;
+        }
+        else if (t < accelTime + cruiseTime){
+            s = peak * accelTime / 2 + peak * (t - accelTime), v = peak, a = 0;
+        }
+        else if (t < duration){
+            double left = duration - t;
+            s = 1 - accel * left * left / 2, v = accel * left, a = -accel;
+        }
+        else {
+            s = 1, v = 0, a = 0;
+        }
+        return {
+            { start.shoulder + delta.shoulder * s, start.elbow + delta.elbow * s },
+            { delta.shoulder * v, delta.elbow * v },
+            { delta.shoulder * a, delta.elbow * a }
+        };
+    }
+};
+
+
+/**
+ @version 1.0
+
+ * A whole move: up to MaxSegments straight lines through waypoints, one after another.
+ */
+class ArmTrajectory {
+public:
+    static constexpr int MaxSegments = 8;
+
+    ArmSegment segments[MaxSegments];
+    int count = 0;
+    bool clear = true; // False if the planner couldn't find a way round the obstacles and this just goes straight there
+
+    double Duration() const {
+        double ret = 0;
+        for (int i = 0; i < count; i ++){
+            ret += segments[i].duration;
+        }
+        return ret;
+    }
+
+    /**
+     * Where the arm should be some time after the move started
+     @param t Seconds since the start
+     */
+    ArmSample Sample(double t) const {
+        for (int i = 0; i < count - 1; i ++){
+            if (t < segments[i].duration){
+                return segments[i].Sample(t);
+            }
+            t -= segments[i].duration;
+        }
+        return segments[count - 1].Sample(t);
+    }
+
+    ArmJoints End() const {
+        const ArmSegment& last = segments[count - 1];
+        return { last.start.shoulder + last.delta.shoulder, last.start.elbow + last.delta.elbow };
+    }
+};
+
+
+/**
+ @version 1.0
+
+ * Plans ArmTrajectories around obstacles, and remembers the last few so going between the same positions again costs nothing.
+
+ * Planning goes: straight there if that's clear; else through the via point if there is one and that's clear; else A* on a grid over joint space
+ * (with travel time as the cost, so it finds the quickest route, not the shortest), then cut the grid path down to as few straight lines as stay clear.
+ * Each line gets the fastest synchronized profile the joint limits allow.
+
+ * Usage:
+ * const ArmTrajectory& move = planner.Plan(current, goal);
+ * ArmSample target = move.Sample(Clock::Now() - moveStart);
+ */
+class ArmPlanner {
+    static constexpr int GridSize = 64;
+    static constexpr int Cells = GridSize * GridSize;
+    static constexpr double CellSize = 2 * cexpr::pi / GridSize;
+    static constexpr double CheckStep = cexpr::pi / 180; // Straight lines are checked every degree
+    static constexpr int CacheSize = 8;
+    static constexpr int KeySize = 6; // Start, goal and via, each to the nearest degree
+    static constexpr int NoVia = 1 << 30; // In the via's place in the key when there isn't one
+
+    uint16_t edges[Cells]; // Bit (ds + 1) * 3 + (de + 1) is set if the straight line to the neighbour at (+ds, +de) is clear
+
+    // A* state, kept here so planning doesn't need the stack or the heap
+    float cost[Cells];
+    int16_t parent[Cells];
+    int16_t heap[Cells];
+    int16_t heapIndex[Cells]; // Where each cell is in heap, -1 if it isn't
+    float priority[Cells];
+    int heapSize;
+    int16_t path[Cells];
+
+    struct CacheEntry {
+        int key[KeySize];
+        long lastUsed = -1;
+        ArmTrajectory trajectory;
+    };
+    CacheEntry cache[CacheSize];
+    long uses = 0;
+
+    static int cellOf(double angle, double min){
+        int c = (int)((angle - min) / CellSize);
+        return c < 0 ? 0 : (c >= GridSize ? GridSize - 1 : c);
+    }
+
+    static int cellOf(const ArmJoints& joints){
+        return cellOf(joints.shoulder, -cexpr::pi / 2) * GridSize + cellOf(joints.elbow, -3 * cexpr::pi / 2);
+    }
+
+    static ArmJoints centerOf(int cell){
+        return { -cexpr::pi / 2 + (cell / GridSize + 0.5) * CellSize, -3 * cexpr::pi / 2 + (cell % GridSize + 0.5) * CellSize };
+    }
+
+    double travelTime(const ArmJoints& a, const ArmJoints& b) const {
+        double s = std::abs(b.shoulder - a.shoulder) / constants.maxVelocity[0];
+        double e = std::abs(b.elbow - a.elbow) / constants.maxVelocity[1];
+        return s > e ? s : e;
+    }
+
+    void heapSwap(int a, int b){
+        int16_t t = heap[a];
+        heap[a] = heap[b];
+        heap[b] = t;
+        heapIndex[heap[a]] = a;
+        heapIndex[heap[b]] = b;
+    }
+
+    void heapUp(int i){
+        while (i > 0 && priority[heap[(i - 1) / 2]] > priority[heap[i]]){
+            heapSwap(i, (i - 1) / 2);
+            i = (i - 1) / 2;
+        }
+    }
+
+    void heapPush(int cell, float p){
+        priority[cell] = p;
+        if (heapIndex[cell] == -1){
+            heap[heapSize] = cell;
+            heapIndex[cell] = heapSize;
+            heapSize ++;
+        }
+        heapUp(heapIndex[cell]);
+    }
+
+    int heapPop(){
+        int ret = heap[0];
+        heapSwap(0, heapSize - 1);
+        heapSize --;
+        heapIndex[ret] = -1;
+        int i = 0;
+        while (true){
+            int smallest = i;
+            int l = 2 * i + 1;
+            int r = l + 1;
+            if (l < heapSize && priority[heap[l]] < priority[heap[smallest]]){
+                smallest = l;
+            }
+            if (r < heapSize && priority[heap[r]] < priority[heap[smallest]]){
+                smallest = r;
+            }
+            if (smallest == i){
+                break;
+            }
+            heapSwap(i, smallest);
+            i = smallest;
+        }
+        return ret;
+    }
+
+    /**
+     * A* from start's cell to goal's cell. Fills path (goal first) and returns its length, or 0 if there's no way through.
+     * Only moves along clear edges. Out of the start's cell and into the goal's, what counts is the line from the start or to the goal, not the cells' centers,
+     * so being in a blocked cell (or right by an obstacle) doesn't strand either end.
+     */
+    int search(const ArmJoints& start, const ArmJoints& goal){
+        int from = cellOf(start);
+        int to = cellOf(goal);
+        for (int i = 0; i < Cells; i ++){
+            cost[i] = 1e30f;
+            heapIndex[i] = -1;
+            parent[i] = -1;
+        }
+        heapSize = 0;
+        cost[from] = 0;
+        heapPush(from, travelTime(centerOf(from), centerOf(to)));
+        while (heapSize > 0){
+            int cell = heapPop();
+            if (cell == to){
+                int length = 0;
+                for (int c = to; c != -1; c = parent[c]){
+                    path[length ++] = c;
+                }
+                return length;
+            }
+            int cs = cell / GridSize;
+            int ce = cell % GridSize;
+            for (int ds = -1; ds <= 1; ds ++){
+                for (int de = -1; de <= 1; de ++){
+                    int ns = cs + ds;
+                    int ne = ce + de;
+                    if ((ds == 0 && de == 0) || ns < 0 || ns >= GridSize || ne < 0 || ne >= GridSize){
+                        continue;
+                    }
+                    int next = ns * GridSize + ne;
+                    bool clear;
+                    if (cell == from){
+                        clear = PathClear(start, centerOf(next));
+                    }
+                    else if (next == to){
+                        clear = PathClear(centerOf(cell), goal);
+                    }
+                    else {
+                        clear = edges[cell] & (1 << ((ds + 1) * 3 + (de + 1)));
+                    }
+                    if (!clear){
+                        continue;
+                    }
+                    float c = cost[cell] + travelTime(centerOf(cell), centerOf(next));
+                    if (c < cost[next]){
+                        cost[next] = c;
+                        parent[next] = cell;
+                        heapPush(next, c + travelTime(centerOf(next), centerOf(to)));
+                    }
+                }
+            }
+        }
+        return 0;
+    }
+
+    void build(ArmTrajectory& ret, const ArmJoints* points, int count){
+        ret.count = 0;
+        for (int i = 0; i + 1 < count; i ++){
+            ret.segments[ret.count ++] = ArmSegment::Plan(points[i], points[i + 1], constants);
+        }
+    }
+
+    void plan(ArmTrajectory& ret, const ArmJoints& start, const ArmJoints& goal, const ArmJoints* via){
+        ret.clear = ArmAllowed(goal, constants); // If the goal's in something (or past a limit) there's no clear way there; go straight
+        if (!ret.clear || PathClear(start, goal)){
+            ArmJoints points[] = { start, goal };
+            build(ret, points, 2);
+            return;
+        }
+        if (via && PathClear(start, *via) && PathClear(*via, goal)){
+            ArmJoints points[] = { start, *via, goal };
+            build(ret, points, 3);
+            return;
+        }
+        int length = search(start, goal);
+        if (length > 0){
+            // Shortcut: from each waypoint, go to the point along the grid path nearest the goal that's in a clear straight line
+            ArmJoints points[ArmTrajectory::MaxSegments + 1];
+            int count = 0;
+            points[count ++] = start;
+            int at = length; // Index into path of the last waypoint; path[0] is the goal's cell, length means the start
+            while (true){
+                ArmJoints from = points[count - 1];
+                if (PathClear(from, goal)){
+                    points[count ++] = goal;
+                    build(ret, points, count);
+                    return;
+                }
+                if (count == ArmTrajectory::MaxSegments){
+                    break; // Too twisty to fit
+                }
+                int next = -1;
+                for (int i = 0; i < at; i ++){
+                    if (PathClear(from, centerOf(path[i]))){
+                        next = i;
+                        break;
+                    }
+                }
+                if (next == -1){
+                    break;
+                }
+                points[count ++] = centerOf(path[next]);
+                at = next;
+            }
+        }
+        ret.clear = false; // Nothing clear; best we can do is go straight there
+        ArmJoints direct[] = { start, goal };
+        build(ret, direct, 2);
+    }
+
+public:
+    ArmPlannerConstants constants;
+
+    ArmPlanner(){
+        Rebuild();
+    }
+
+    /**
+     * Work out which grid edges are clear and forget every cached trajectory. Call after changing constants.
+     */
+    void Rebuild(){
+        for (int i = 0; i < Cells; i ++){
+            edges[i] = 0;
+        }
+        for (int i = 0; i < Cells; i ++){
+            int cs = i / GridSize;
+            int ce = i % GridSize;
+            for (int ds = 0; ds <= 1; ds ++){ // Each edge once, going up in shoulder (or along in elbow); then mirror it onto the other cell
+                for (int de = -1; de <= 1; de ++){
+                    int ns = cs + ds;
+                    int ne = ce + de;
+                    if ((ds == 0 && de != 1) || ns >= GridSize || ne < 0 || ne >= GridSize){
+                        continue;
+                    }
+                    int next = ns * GridSize + ne;
+                    if (ArmAllowed(centerOf(i), constants) && PathClear(centerOf(i), centerOf(next))){
+                        edges[i] |= 1 << ((ds + 1) * 3 + (de + 1));
+                        edges[next] |= 1 << ((1 - ds) * 3 + (1 - de));
+                    }
+                }
+            }
+        }
+        for (CacheEntry& entry : cache){
+            entry.lastUsed = -1;
+        }
+    }
+
+    /**
+     * Whether the straight line between two joint positions stays out of every obstacle and inside the joint limits. The start is allowed to be in one, so the arm can always get back out.
+     */
+    bool PathClear(const ArmJoints& a, const ArmJoints& b) const {
+        double span = travelTime(a, b) * (constants.maxVelocity[0] > constants.maxVelocity[1] ? constants.maxVelocity[0] : constants.maxVelocity[1]);
+        int steps = (int)(span / CheckStep) + 1;
+        for (int i = 1; i <= steps; i ++){
+            double s = (double)i / steps;
+            if (!ArmAllowed({ a.shoulder + (b.shoulder - a.shoulder) * s, a.elbow + (b.elbow - a.elbow) * s }, constants)){
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * A trajectory from start to goal. Cached by start, goal and via (to the nearest degree), so repeat moves don't get planned again.
+     @param start Where the arm is
+     @param goal Where it's going
+     @param via A point to try going through if the straight line isn't clear (an ArmPreset's clearance point), or nullptr
+     */
+    const ArmTrajectory& Plan(const ArmJoints& start, const ArmJoints& goal, const ArmJoints* via = nullptr){
+        int key[KeySize] = {
+            (int)std::lround(start.shoulder / CheckStep), (int)std::lround(start.elbow / CheckStep),
+            (int)std::lround(goal.shoulder / CheckStep), (int)std::lround(goal.elbow / CheckStep),
+            via ? (int)std::lround(via -> shoulder / CheckStep) : NoVia, via ? (int)std::lround(via -> elbow / CheckStep) : NoVia
+        };
+        uses ++;
+        CacheEntry* oldest = &cache[0];
+        for (CacheEntry& entry : cache){
+            if (entry.lastUsed != -1 && std::equal(key, key + KeySize, entry.key)){
+                entry.lastUsed = uses;
+                return entry.trajectory;
+            }
+            if (entry.lastUsed < oldest -> lastUsed){
+                oldest = &entry;
+            }
+        }
+        plan(oldest -> trajectory, start, goal, via);
+        for (int i = 0; i < KeySize; i ++){
+            oldest -> key[i] = key[i];
+        }
+        oldest -> lastUsed = uses;
+        return oldest -> trajectory;
+    }
+};
@@ -114,25 +114,20 @@ class AwesomeRobot : public frc::RobotBase {
     std::atomic<bool> m_exit = false;
 
     /**
-     * Heap allocated teleop mode object.
-     * Stack allocation *would* have been better, but I really wanted to be able to say "activeMode == disabled" without having to take a reference every time, and activeMode does in fact have to be a pointer.
+     * The mode objects themselves. They live inside the AwesomeRobot, so nothing here touches the heap.
      */
-    TeleopModeType* teleop = new TeleopModeType;
-    /**
-     * Heap allocated autonomous mode object
-     * See {@link teleop}
-     */
-    AutonomousModeType* autonomous = new AutonomousModeType;
-    /**
-     * Heap allocated test mode object.
-     * See {@link teleop}
-     */
-    TestModeType* test = new TestModeType;
+    TeleopModeType teleopMode;
+    AutonomousModeType autonomousMode;
+    TestModeType testMode;
+    DisabledModeType disabledMode;
+
     /**
-     * Heap allocated disabled mode object.
-     * See {@link teleop}
+     * Pointers to the modes, so we can say "activeMode == disabled" without taking a reference every time.
      */
-    DisabledModeType* disabled = new DisabledModeType;
+    TeleopModeType* teleop = &teleopMode;
+    AutonomousModeType* autonomous = &autonomousMode;
+    TestModeType* test = &testMode;
+    DisabledModeType* disabled = &disabledMode;
 
     /**
      * Store a pointer to the active mode. If this is 0, no mode is active. This is default, safe, and checked for; it will only be 0 until the robot turns on and does the disabled check.
@@ -230,7 +225,7 @@ public:
                     std::cout << "Switched to Teleop Mode" << std::endl;
                 }
             }
-            activeMode -> Synchronous(); // Synchronous looping
+            activeMode -> Synchronous(); // Synchronous looping. Modes hold their own AllocationGuard over their control path (see Robot.cpp)
         }
     }
 
@@ -1,6 +1,9 @@
 #pragma once
 /* By Tyler Clarke. Base class for polymorphing highly compatible motors */
 
+#include <concepts>
+#include "StatusFrames.hpp"
+
 
 /**
  @author Tyler Clarke and Luke White
@@ -93,4 +96,45 @@ public:
     virtual void ConfigIdleToBrake() = 0;
 
     virtual double GetCurrent() = 0;
+
+    /**
+     * Set the status frame periods to match what actually gets read off this motor (see StatusFrames.hpp). Motors that can't do this ignore it.
+     @param needs What gets read, and how often
+     */
+    virtual void SetStatusFrames(StatusNeeds needs) {}
+};
+
+
+/**
+ @author Tyler Clarke and Luke White
+ @version 1.0
+
+ * Static motor interface. Anything that can do what a BaseMotor does satisfies it - BaseMotor itself included.
+
+ * Template on this instead of holding a BaseMotor*: SwerveModule<SparkMotor, SparkMotor> knows exactly which functions it's calling, so they inline.
+ * BaseMotor is still there as the adapter for code that really wants to mix motor types at runtime.
+ */
+template <typename T>
+concept MotorType = requires(T& t, double d, bool b){
+    t.SetPercent(d);
+    t.SetInverted(b);
+    t.SetInverted();
+    { t.inversionState } -> std::convertible_to<bool>;
+    { t.GetPosition() } -> std::convertible_to<double>;
+    { t.GetVelocity() } -> std::convertible_to<double>;
+    { t.GetCurrent() } -> std::convertible_to<double>;
+    t.ConfigIdleToBrake();
+    t.SetStatusFrames(StatusNeeds {});
+};
+
+
+/**
+ * A MotorType that can run a position loop on its own controller, off its own encoder (SparkMotor does).
+ */
+template <typename T>
+concept OnboardPositionMotor = MotorType<T> && requires(T& t, double d){
+    t.SetPositionPID(d);
+    t.SetPositionConversionFactor(d);
+    t.SetEncoderPosition(d);
+    t.SetPositionWrapping(d, d);
 };
@@ -1,7 +1,12 @@
 /* Keep safe with a current watcher that emits a warning when a dangerous thing happens to a motor */
+#pragma once
 
+#include <FRL/util/Clock.hpp>
+#include "BaseMotor.hpp"
+
+template <MotorType Motor>
 class CurrentWatcher {
-    BaseMotor* watchee;
+    Motor* watchee;
     double dangerousCurrent;
     double dangerousTime;
     double spikeStartTime = -1;
@@ -11,9 +16,14 @@ class CurrentWatcher {
     bool wasEndangered; // If, at the last cycle, it was spiking
 
 public:
+    /**
+     * What this needs from the motor it watches: current, every tick
+     */
+    static constexpr StatusNeeds Needs { .currentMs = LOOP_PERIOD_MS };
+
     bool isEndangered = true;
 
-    CurrentWatcher(BaseMotor* bm, double dangerCurrent, double dangerCurrentSecs, double cooldown = 1){
+    CurrentWatcher(Motor* bm, double dangerCurrent, double dangerCurrentSecs, double cooldown = 1){
         watchee = bm;
         dangerousCurrent = dangerCurrent;
         dangerousTime = dangerCurrentSecs;
@@ -21,8 +31,12 @@ public:
     }
 
     bool Update(){ // Returns whether it's safe or not
-        double cTime = (double)frc::Timer::GetFPGATimestamp(); /* Todo: replace with clock code that doesn't depend on wpilib */
-        if (watchee -> GetCurrent() > dangerousCurrent){
+        return Update(watchee -> GetCurrent());
+    }
+
+    bool Update(double current){ // Same, but with a current someone else already read (a sensor snapshot)
+        double cTime = Clock::Now();
+        if (current > dangerousCurrent){
             if (spikeStartTime == -1){
                 spikeStartTime = cTime;
             }
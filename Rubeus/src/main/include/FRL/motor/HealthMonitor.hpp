@@ -0,0 +1,159 @@
+/* Motor health monitoring: rolling current statistics and an I²t thermal model for every motor on the robot, in one place.
+    Instead of a hard cutoff, each motor gets a derating factor that eases its output down as it heats up.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <FRL/motor/StatusFrames.hpp>
+
+
+/**
+ * What the monitor needs off every motor. Heat builds up over seconds, so current every 100ms is plenty.
+ */
+constexpr StatusNeeds HealthMonitorStatus { .currentMs = 100 };
+
+
+/**
+ @version 1.0
+
+ * Thermal limits for one motor. Tune by altering them directly, same as PIDConstants.
+
+ * A motor can run ContinuousCurrent forever. Above that it builds up heat (I²t, in A²s); PeakCurrent is allowed for PeakTime seconds from cold.
+ * Derating starts once DerateStart of that budget is used, and reaches MinDerate when it's all used.
+ */
+struct MotorThermalConstants {
+    double ContinuousCurrent = 40; // NEO on a 40A breaker
+    double PeakCurrent = 80;
+    double PeakTime = 2;
+    double DerateStart = 0.7;
+    double MinDerate = 0.3; // Never derate below this; it's not a cutoff
+};
+
+constexpr MotorThermalConstants NEO_THERMAL {};
+constexpr MotorThermalConstants NEO550_THERMAL { .ContinuousCurrent = 20, .PeakCurrent = 40, .PeakTime = 2 }; // Tiny motor, cooks fast
+
+
+/**
+ @version 1.0
+
+ * Keeps a fixed window of current samples for Motors motors, and from them a rolling mean, an I²t heat estimate and a derating factor for each.
+
+ * Everything is stored motor-minor (sample[i][motor]), so every step of Record is one straight loop over contiguous arrays that the compiler vectorizes.
+ * Nothing is ever allocated and nothing in here reads hardware or a clock: feed it currents from a sensor snapshot and the time since the last one.
+
+ * Usage:
+ * health.Record(currents, dt); // every tick
+ * module.SetOutputScale(health.Derate(FRONT_LEFT_SPEED), ...);
+ */
+template <size_t Motors, size_t Window = 50>
+class HealthMonitor {
+    static_assert(Motors > 0 && Window > 0, "Nothing to monitor");
+
+    float samples[Window][Motors] = {};
+    size_t head = 0;
+    size_t count = 0;
+
+    // Per-motor state, one array each so the loops in Record stay vectorizable
+    double sum[Motors] = {};
+    double heat[Motors] = {}; // A²s above continuous
+    double derate[Motors];
+    double continuousSq[Motors];
+    double budget[Motors]; // A²s it takes to hit MinDerate
+    double derateStart[Motors];
+    double derateSlope[Motors];
+    double minDerate[Motors];
+
+public:
+    HealthMonitor(){
+        for (size_t m = 0; m < Motors; m ++){
+            derate[m] = 1;
+            SetConstants(m, NEO_THERMAL);
+        }
+    }
+
+    /**
+     * Set a motor's thermal limits. Call at boot.
+     @param motor Index of the motor
+     @param constants Its limits
+     */
+    void SetConstants(size_t motor, const MotorThermalConstants& constants){
+        continuousSq[motor] = constants.ContinuousCurrent * constants.ContinuousCurrent;
+        budget[motor] = (constants.PeakCurrent * constants.PeakCurrent - continuousSq[motor]) * constants.PeakTime;
+        derateStart[motor] = constants.DerateStart;
+        derateSlope[motor] = (1 - constants.MinDerate) / (1 - constants.DerateStart);
+        minDerate[motor] = constants.MinDerate;
+    }
+
+    /**
+     * Record one current sample for every motor and update everything.
+     @param currents Current of each motor, in amps
+     @param dt Seconds since the last Record
+     */
+    void Record(const double (&currents)[Motors], double dt){
+        float* slot = samples[head];
+        if (count == Window){
+            for (size_t m = 0; m < Motors; m ++){
+                sum[m] -= slot[m]; // Oldest sample drops out of the window
+            }
+        }
+        else {
+            count ++;
+        }
+        for (size_t m = 0; m < Motors; m ++){
+            slot[m] = currents[m];
+            sum[m] += currents[m];
+        }
+        head = (head + 1) % Window;
+
+        for (size_t m = 0; m < Motors; m ++){
+            double h = heat[m] + (currents[m] * currents[m] - continuousSq[m]) * dt; // Below continuous it cools off at the same rate
+            h = h < 0 ? 0 : (h > budget[m] ? budget[m] : h); // Past the budget it's at MinDerate anyway; don't make it wait forever to cool off
+            heat[m] = h;
+            double over = h / budget[m] - derateStart[m];
+            double d = 1 - (over > 0 ? over : 0) * derateSlope[m];
+            derate[m] = d < minDerate[m] ? minDerate[m] : d;
+        }
+    }
+
+    /**
+     * Output multiplier for a motor: 1 when it's cool, easing down to MinDerate as it uses up its I²t budget
+     */
+    double Derate(size_t motor){
+        return derate[motor];
+    }
+
+    /**
+     * Mean current over the window, in amps
+     */
+    double Mean(size_t motor){
+        return count == 0 ? 0 : sum[motor] / count;
+    }
+
+    /**
+     * How much of the I²t budget a motor has used, 0-1
+     */
+    double Heat(size_t motor){
+        return heat[motor] / budget[motor];
+    }
+
+    /**
+     * Newest current sample for a motor
+     */
+    double Latest(size_t motor){
+        return count == 0 ? 0 : samples[(head + Window - 1) % Window][motor];
+    }
+
+    /**
+     * Forget all history; every motor is cold again
+     */
+    void Reset(){
+        head = 0;
+        count = 0;
+        for (size_t m = 0; m < Motors; m ++){
+            sum[m] = 0;
+            heat[m] = 0;
+            derate[m] = 1;
+        }
+    }
+};
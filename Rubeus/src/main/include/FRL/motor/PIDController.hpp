@@ -5,7 +5,7 @@
 // This is entirely based off the code at https://docs.revrobotics.com/sparkmax/operating-modes/closed-loop-control, squeezed into a C++ format
 #pragma once
 #include "BaseMotor.hpp"
-#include <frc/Timer.h>
+#include <FRL/util/Clock.hpp>
 
 
 /**
@@ -77,7 +77,7 @@ class PIDController {
     /**
      * Timestamp at the last update
      */
-    double lastTime;
+    double lastTime = 0;
     /**
      * Frequency to update at.
      */
@@ -107,6 +107,11 @@ class PIDController {
      */
     long rotationLength = -1; // -1 = no looping
 
+    /**
+     * What the last Update sent the motor, before outputScale.
+     */
+    double lastOutput = 0;
+
     /**
      * Calculate error between a setpoint and current position *based on the fact that there are always 2 ways to reach any given point on a circle*.
      
@@ -178,6 +183,17 @@ public:
      */
     PIDConstants constants;
 
+    /**
+     * Multiplies the output after it's clamped. Set every tick by whoever is derating the motor (see HealthMonitor); 1 means full output.
+     */
+    double outputScale = 1;
+
+    /**
+     * Added to the output after it's clamped, so MinOutput and MaxOutput only limit what the feedback does. Set every tick by whoever knows what the mechanism
+     * needs to hold still or follow a motion (see Arm), so PID only has to fix the error.
+     */
+    double feedforward = 0;
+
     /**
      * Turn on looping-mode and set the circumference of one "circle"
      @param circumference The circumference to loop around
@@ -209,7 +225,7 @@ public:
         }
     }
 
-    double speedAccumulated;
+    double speedAccumulated = 0;
 
     /**
      * Update the motor with a current position specified. Call periodically. The hz-smoothing algorithm means the frequency doesn't matter too much, but try to call it at least as many times per second as the frequency, and preferably not too many more. The algorithm breaks down at the extremes.
@@ -221,7 +237,7 @@ public:
             return;
         }
         curPos = cPos;
-        double secsElapsed = (double)frc::Timer::GetFPGATimestamp() - lastTime;
+        double secsElapsed = Clock::Now() - lastTime;
         double FE = secsElapsed / hz; // This is a trick from my online game. Measures elapsed time and converts it to number of ticks it needs to "draw"!
         // The roborio has at least a few mhz so this will almost never be >1, and will probably hover <0.1 most of the time.
         // We can set up SmartDashboard to track it for performance metrics, if it becomes necessary
@@ -236,8 +252,18 @@ public:
         else if (ret < constants.MinOutput){
             ret = constants.MinOutput;
         }
-        motor -> SetPercent(ret);
-        lastTime = (double)frc::Timer::GetFPGATimestamp();
+        ret += feedforward;
+        ret = ret > 1 ? 1 : (ret < -1 ? -1 : ret);
+        lastOutput = ret;
+        motor -> SetPercent(ret * outputScale);
+        lastTime = Clock::Now();
+    }
+
+    /**
+     * What the last Update sent the motor (-1 to 1, before outputScale)
+     */
+    double GetOutput(){
+        return lastOutput;
     }
 
     /**
@@ -0,0 +1,142 @@
+/* Brownout-aware power budgeting.
+    The battery sags under load, and if it sags far enough the RIO browns out and drops everything.
+    This works out how much current the battery can give before that happens, and shares it out between subsystems by priority.
+*/
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+
+/**
+ @version 1.0
+
+ * Brushed-model constants for a motor, for predicting current from a command. Defaults are a NEO.
+ */
+struct DCMotor {
+    double Kv = 473; // RPM per volt
+    double Resistance = 12.0 / 105; // Ohms: 12V over stall current
+
+    /**
+     * Current the motor will draw at some command and speed. Back EMF cancels some of the applied voltage; the rest goes through the windings.
+     @param command Output, -1 to 1
+     @param rpm Motor speed, RPM
+     @param voltage Bus voltage
+     */
+    constexpr double Current(double command, double rpm, double voltage) const {
+        double i = (command * voltage - rpm / Kv) / Resistance;
+        return i < 0 ? -i : i;
+    }
+};
+
+
+/**
+ @version 1.0
+
+ * Constants for PowerManager. Tune by altering them directly, same as PIDConstants.
+ */
+struct PowerConstants {
+    double BatteryResistance = 0.018; // Ohms: battery (about 12 milliohms on the datasheet), main breaker and wiring. Not measured yet: (resting voltage - voltage under a known load) / load
+    double TargetVoltage = 7.5; // Keep the predicted voltage above this. The RIO browns out at 6.8.
+    double BaseLoad = 3; // Amps the RIO, radio and everything else draw no matter what
+    double RecoverRate = 2; // How fast (per second) a consumer's scale comes back once there's room. Cuts are immediate.
+    double OpenVoltageFilter = 0.05; // How much of each new open-circuit voltage estimate goes into the filtered one, 0-1
+};
+
+
+/**
+ @version 1.0
+
+ * Shares a current budget between Consumers consumers, most important first.
+
+ * Each tick it's told the battery voltage, the current actually being drawn, and how much each consumer wants.
+ * From the voltage under load it estimates the battery's open-circuit voltage, and from that how much current
+ * it can give before the voltage drops to TargetVoltage. Consumers are granted their demand in priority order until it runs out;
+ * each one's output scale is its grant over its demand.
+
+ * Demands are at the voltage now, but a motor's current falls with the voltage across it (all the way in proportion when it's stalled,
+ * more than that when it's turning), so what they'd really draw with the battery sagged to TargetVoltage is at most demand * TargetVoltage / voltage.
+ * That's what gets granted. Counting full stall current at a full battery would throttle every launch from rest, when the sag itself keeps the current down.
+
+ * Scales drop straight away, and come back at RecoverRate, so nothing snaps back to full the instant the voltage recovers.
+ * Nothing in here reads hardware or a clock.
+
+ * Usage:
+ * power.Update(batteryVoltage, totalCurrent, { driveDemand, armDemand, compressorDemand }, dt); // every tick
+ * swerve.SetOutputScale(power.Scale(0), ...);
+ */
+template <size_t Consumers>
+class PowerManager {
+    double scale[Consumers];
+    double openVoltage = 12.5;
+    double budget = 0;
+
+public:
+    PowerConstants constants;
+
+    PowerManager(){
+        for (size_t i = 0; i < Consumers; i ++){
+            scale[i] = 1;
+        }
+    }
+
+    /**
+     * Work out this tick's budget and scales.
+     @param voltage Measured battery voltage
+     @param measured Total current being drawn right now, amps (not counting BaseLoad)
+     @param demand Current each consumer wants at full command, amps, most important first
+     @param dt Seconds since the last Update
+     */
+    void Update(double voltage, double measured, const double (&demand)[Consumers], double dt){
+        double open = voltage + (measured + constants.BaseLoad) * constants.BatteryResistance;
+        openVoltage += (open - openVoltage) * constants.OpenVoltageFilter;
+        budget = (openVoltage - constants.TargetVoltage) / constants.BatteryResistance - constants.BaseLoad;
+
+        double sag = voltage > 0 ? constants.TargetVoltage / voltage : 1; // Demands at the target voltage, from demands at this one
+        double remaining = budget;
+        for (size_t i = 0; i < Consumers; i ++){
+            double wanted = demand[i] * sag;
+            double grant = wanted < remaining ? wanted : remaining;
+            grant = grant < 0 ? 0 : grant;
+            remaining -= grant;
+            double target = wanted > 0 ? grant / wanted : 1;
+            if (target < scale[i]){
+                scale[i] = target;
+            }
+            else {
+                scale[i] += constants.RecoverRate * dt;
+                scale[i] = scale[i] > target ? target : scale[i];
+            }
+        }
+    }
+
+    /**
+     * Output multiplier for a consumer, 0-1
+     */
+    double Scale(size_t consumer){
+        return scale[consumer];
+    }
+
+    /**
+     * Total current available to the consumers this tick, amps, with the battery at TargetVoltage
+     */
+    double Budget(){
+        return budget;
+    }
+
+    /**
+     * Filtered open-circuit battery voltage estimate
+     */
+    double OpenVoltage(){
+        return openVoltage;
+    }
+
+    /**
+     * Voltage the battery would sag to at some total current
+     @param current Total current, amps (not counting BaseLoad)
+     */
+    double PredictVoltage(double current){
+        return openVoltage - (current + constants.BaseLoad) * constants.BatteryResistance;
+    }
+};
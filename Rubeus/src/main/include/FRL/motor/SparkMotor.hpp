@@ -1,4 +1,5 @@
 /* Spark MAX motor; can be used as a BaseMotor. */
+#pragma once
 
 
 #include <rev/CANSparkMax.h> /* Requires REVLib */
@@ -16,70 +17,119 @@ struct _SparkMotorEncoderControlContainer{
  @version 1.0
 
  * Motor wrapper for Spark Max.
+
+ * final, so anything holding an actual SparkMotor (not a BaseMotor*) calls straight into it with no virtual dispatch.
  */
-class SparkMotor : public BaseMotor {
+class SparkMotor final : public BaseMotor {
 public:
-    _SparkMotorEncoderControlContainer* controls;
-    rev::CANSparkMax* spark;
+    rev::CANSparkMax spark; // Declared before controls: controls is built from it
+    _SparkMotorEncoderControlContainer controls;
 
     /**
-     * Construct a spark motor. Creates a new rev::CANSparkMax.
+     * Construct a spark motor. The rev::CANSparkMax lives inside the SparkMotor, so nothing is heap allocated.
      @param canID The CAN id of the Spark Max it's wrapping.
      */
-    SparkMotor(int canID){
-        spark = new rev::CANSparkMax (canID, rev::CANSparkMax::MotorType::kBrushless);
-        controls = new _SparkMotorEncoderControlContainer {spark -> GetEncoder(), spark -> GetPIDController()};
+    SparkMotor(int canID) : spark { canID, rev::CANSparkMax::MotorType::kBrushless }, controls { spark.GetEncoder(), spark.GetPIDController() } {
+
     }
 
     void _setInverted(bool invert) {
-        spark -> SetInverted(invert);
+        spark.SetInverted(invert);
     }
     
     void SetPercent(double percent){
-        spark -> Set(percent);
+        spark.Set(percent);
     }
 
     void SetP(double kP){
-        controls -> pid.SetP(kP);
+        controls.pid.SetP(kP);
     }
 
     void SetI(double kI){
-        controls -> pid.SetI(kI);
+        controls.pid.SetI(kI);
     }
 
     void SetD(double kD){
-        controls -> pid.SetD(kD);
+        controls.pid.SetD(kD);
     }
 
     void SetF(double kF){
-        controls -> pid.SetFF(kF);
+        controls.pid.SetFF(kF);
     }
 
     void SetOutputRange(double kPeakOF, double kPeakOR, double kNominalOF = 0, double kNominalOR = 0){
-        controls -> pid.SetOutputRange(kPeakOR, kPeakOF); // Ignore nominal values; this is Spark.
+        controls.pid.SetOutputRange(kPeakOR, kPeakOF); // Ignore nominal values; this is Spark.
     }
         
     double GetPosition() {
-        return controls -> encoder.GetPosition();
+        return controls.encoder.GetPosition();
     }
     
     double GetVelocity() {
-        return controls -> encoder.GetVelocity();
+        return controls.encoder.GetVelocity();
     }
         
     void SetPositionPID(double position){
-        controls -> pid.SetReference(position, rev::CANSparkMax::ControlType::kPosition);
+        controls.pid.SetReference(position, rev::CANSparkMax::ControlType::kPosition);
+    }
+
+    /**
+     * Scale the integrated encoder: GetPosition and SetPositionPID work in motor rotations * factor.
+     @param factor Units per motor rotation
+     */
+    void SetPositionConversionFactor(double factor){
+        controls.encoder.SetPositionConversionFactor(factor);
+    }
+
+    /**
+     * Overwrite the integrated encoder's position, in converted units
+     */
+    void SetEncoderPosition(double position){
+        controls.encoder.SetPosition(position);
+    }
+
+    /**
+     * Make the onboard position loop wrap around, so it takes the short way to a setpoint.
+     @param min The lowest position
+     @param max The highest position; the same place as min
+     */
+    void SetPositionWrapping(double min, double max){
+        controls.pid.SetPositionPIDWrappingEnabled(true);
+        controls.pid.SetPositionPIDWrappingMinInput(min);
+        controls.pid.SetPositionPIDWrappingMaxInput(max);
     }
 
     void SetSpeedPID(double speed){
-        controls -> pid.SetReference(speed, rev::CANSparkMax::ControlType::kVelocity);
+        controls.pid.SetReference(speed, rev::CANSparkMax::ControlType::kVelocity);
     }
 
     void ConfigIdleToBrake() {
-        spark -> SetIdleMode(rev::CANSparkMax::IdleMode::kBrake);
+        spark.SetIdleMode(rev::CANSparkMax::IdleMode::kBrake);
     }
 
     double GetCurrent() {
-        return spark -> GetOutputCurrent();
+        return spark.GetOutputCurrent();
+    }
+
+    /**
+     * Status frame periods for some set of needs. Frames are REV's kStatus0 - kStatus6:
+     * 0 is applied output and faults, 1 is velocity, current, temperature and voltage, 2 is position, 3 is the analog sensor, 4 the alternate encoder, 5 and 6 the duty cycle encoder.
+     @param needs What gets read off the motor
+     */
+    static constexpr StatusPlan<7> PlanStatusFrames(StatusNeeds needs){
+        int telemetry = StatusNeeds::Fastest(needs.velocityMs, needs.currentMs);
+        return {{
+            needs.outputMs ? needs.outputMs : 100, // Faults still show up, just slower
+            telemetry ? telemetry : 500,
+            needs.positionMs ? needs.positionMs : 500,
+            1000, 1000, 1000, 1000 // Sensors we don't have plugged in
+        }};
+    }
+
+    void SetStatusFrames(StatusNeeds needs){
+        auto plan = PlanStatusFrames(needs);
+        for (size_t i = 0; i < plan.periodMs.size(); i ++){
+            spark.SetPeriodicFramePeriod((rev::CANSparkMaxLowLevel::PeriodicFrame)i, plan.periodMs[i]);
+        }
     }
 };
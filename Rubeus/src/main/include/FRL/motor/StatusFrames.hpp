@@ -0,0 +1,89 @@
+/* CAN status frame planning.
+    Motor controllers broadcast their telemetry on a timer whether anyone reads it or not. Subsystems say what they actually read (StatusNeeds),
+    each motor type turns that into frame periods, and the same numbers give the bus load, all at compile time.
+*/
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+
+/**
+ * Period of the control loop, in milliseconds. Synchronous() runs off driver station packets, which come every 20ms; there's no point getting telemetry faster than that.
+ */
+constexpr int LOOP_PERIOD_MS = 20;
+
+/**
+ * CAN bitrate on the RoboRIO, bits per second
+ */
+constexpr double CAN_BITRATE = 1000000;
+
+/**
+ * Bits on the wire per frame: an extended-ID frame with 8 data bytes is 131 bits, plus roughly 10% bit stuffing.
+ */
+constexpr double CAN_BITS_PER_FRAME = 144;
+
+
+/**
+ @version 1.0
+
+ * What a subsystem reads from a motor, and how often. Each field is a period in milliseconds; 0 means it's never read.
+ * Combine two subsystems' needs on the same motor with |, which keeps the faster of each.
+ */
+struct StatusNeeds {
+    int outputMs = 0; // Applied output and faults
+    int velocityMs = 0;
+    int positionMs = 0;
+    int currentMs = 0;
+
+    /**
+     * The faster of two periods, where 0 means "not needed"
+     */
+    static constexpr int Fastest(int a, int b){
+        if (a == 0){
+            return b;
+        }
+        if (b == 0){
+            return a;
+        }
+        return a < b ? a : b;
+    }
+
+    constexpr StatusNeeds operator|(const StatusNeeds& other) const {
+        return {
+            Fastest(outputMs, other.outputMs),
+            Fastest(velocityMs, other.velocityMs),
+            Fastest(positionMs, other.positionMs),
+            Fastest(currentMs, other.currentMs)
+        };
+    }
+};
+
+
+/**
+ @version 1.0
+
+ * A period, in milliseconds, for every status frame a device sends. Frame order is up to the motor type that made it.
+ */
+template <size_t Frames>
+struct StatusPlan {
+    std::array<int, Frames> periodMs;
+
+    constexpr double FramesPerSecond() const {
+        double ret = 0;
+        for (int period : periodMs){
+            ret += 1000.0 / period;
+        }
+        return ret;
+    }
+};
+
+
+/**
+ * Fraction of the CAN bus (0-1) that some number of frames per second will take up.
+ @param framesPerSecond Total frames per second from everything on the bus
+ */
+constexpr double CANBusLoad(double framesPerSecond){
+    return framesPerSecond * CAN_BITS_PER_FRAME / CAN_BITRATE;
+}
@@ -11,28 +11,41 @@
  * Talon FX Motor wrapper.
  */
 
-class TalonFXMotor : public BaseMotor{
-    TalonFX* talon;
+class TalonFXMotor final : public BaseMotor{
+    TalonFX talon;
     bool invert = false;
+
+    /**
+     * The frames PlanStatusFrames plans, in order
+     */
+    static constexpr StatusFrameEnhanced statusFrames[] = {
+        Status_1_General,
+        Status_2_Feedback0,
+        Status_Brushless_Current,
+        Status_4_AinTempVbat,
+        Status_10_MotionMagic,
+        Status_13_Base_PIDF0,
+        Status_21_FeedbackIntegrated
+    };
 public:
     /**
      * Construct a Talon FX
      @param canID The CAN id of the Talon it's wrapping
      */
-    TalonFXMotor (int canID){
-        talon = new TalonFX(canID);
+    TalonFXMotor (int canID) : talon { canID } {
+
     }
 
     void SetPercent(double speed){
         if (speed < 0) {
-            talon -> SetInverted(!invert);
+            talon.SetInverted(!invert);
             speed *= -1;
         }
         else {
-            talon -> SetInverted(invert);
+            talon.SetInverted(invert);
         }   
         
-        talon -> Set(ControlMode::PercentOutput, speed);
+        talon.Set(ControlMode::PercentOutput, speed);
     }
 
     void _setInverted(bool doInv) {
@@ -40,65 +53,86 @@ public:
     }
     
     void SetP(double kP){
-        talon -> Config_kP(0, kP);
+        talon.Config_kP(0, kP);
     }
 
     void SetI(double kI){
-        talon -> Config_kI(0, kI);
+        talon.Config_kI(0, kI);
     }
 
     void SetD(double kD){
-        talon -> Config_kD(0, kD);
+        talon.Config_kD(0, kD);
     }
 
     void SetF(double kF){
-        talon -> Config_kF(0, kF);
+        talon.Config_kF(0, kF);
     }
 
     void SetOutputRange(double kPeakOF, double kPeakOR, double kNominalOF = 0, double kNominalOR = 0){
-        talon -> ConfigPeakOutputForward(kPeakOF);
-        talon -> ConfigPeakOutputReverse(kPeakOR);
-        talon -> ConfigNominalOutputForward(kNominalOF);
-        talon -> ConfigNominalOutputReverse(kNominalOR);
+        talon.ConfigPeakOutputForward(kPeakOF);
+        talon.ConfigPeakOutputReverse(kPeakOR);
+        talon.ConfigNominalOutputForward(kNominalOF);
+        talon.ConfigNominalOutputReverse(kNominalOR);
     }
 
     double GetPosition() {
-        return talon -> GetSeletedSensorPosition();
+        return talon.GetSeletedSensorPosition();
     }
     
     double GetVelocity() {
-        return talon -> GetSelectedSensorVelocity();
+        return talon.GetSelectedSensorVelocity();
     }
     
     void SetPositionPID(double position){
         if (position < 0) {
-            talon -> SetInverted(!invert);
+            talon.SetInverted(!invert);
             position *= -1;
         }
         else {
-            talon -> SetInverted(invert);
+            talon.SetInverted(invert);
         }   
             
-        talon -> Set(ControlMode::Position, position);
+        talon.Set(ControlMode::Position, position);
     }
 
     void SetSpeedPID(double speed){
         if (speed < 0) {
-            talon -> SetInverted(!invert);
+            talon.SetInverted(!invert);
             speed *= -1;
         }
         else {
-            talon -> SetInverted(invert);
+            talon.SetInverted(invert);
         }   
         
-        talon -> Set(ControlMode::Velocity, speed);
+        talon.Set(ControlMode::Velocity, speed);
     }
     
     void SetZeroEncoder() {
-        talon -> SetSelectedSensorPosition(0);
+        talon.SetSelectedSensorPosition(0);
     }
 
     double GetCurrent() {
         return 0;
     }
+
+    /**
+     * Status frame periods for some set of needs, in the order of statusFrames. Phoenix takes periods up to 255ms.
+     @param needs What gets read off the motor
+     */
+    static constexpr StatusPlan<7> PlanStatusFrames(StatusNeeds needs){
+        int feedback = StatusNeeds::Fastest(needs.velocityMs, needs.positionMs); // Position and velocity share a frame on a Talon
+        return {{
+            needs.outputMs ? needs.outputMs : 100,
+            feedback ? feedback : 255,
+            needs.currentMs ? needs.currentMs : 255,
+            255, 255, 255, 255 // Temperature/voltage and onboard closed-loop telemetry; nobody reads those
+        }};
+    }
+
+    void SetStatusFrames(StatusNeeds needs){
+        auto plan = PlanStatusFrames(needs);
+        for (size_t i = 0; i < plan.periodMs.size(); i ++){
+            talon.SetStatusFramePeriod(statusFrames[i], plan.periodMs[i]);
+        }
+    }
 };
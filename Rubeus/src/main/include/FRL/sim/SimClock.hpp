@@ -0,0 +1,50 @@
+/* Simulated time. Once it's installed, Clock::Now() is whatever this says, and it only moves when the simulation moves it.
+    Each thread has its own time, so independent simulations can run side by side (see src/tune).
+*/
+
+#pragma once
+
+#include <FRL/util/Clock.hpp>
+
+
+/**
+ @version 1.0
+
+ * Clock for simulations. Nothing here sleeps: time jumps forward as fast as the host can step the physics.
+
+ * Usage:
+ * SimClock::Install(); // once, before anything reads the clock
+ * SimClock::Reset(); // at the start of each run, on the thread doing it
+ * SimClock::Advance(0.001);
+ */
+class SimClock {
+    inline static thread_local double time = 0;
+
+public:
+    static double Now(){
+        return time;
+    }
+
+    /**
+     * Make Clock::Now() read simulated time, starting from 0. Call it before starting any threads.
+     */
+    static void Install(){
+        time = 0;
+        Clock::Use(Now);
+    }
+
+    /**
+     * Put this thread's time back to 0
+     */
+    static void Reset(){
+        time = 0;
+    }
+
+    /**
+     * Move time forward
+     @param dt Seconds
+     */
+    static void Advance(double dt){
+        time += dt;
+    }
+};
@@ -0,0 +1,270 @@
+/* Simulated motor. A BaseMotor backed by a DC motor model turning a lump of inertia, for running robot code on a laptop with no robot attached.
+    It does what a Spark MAX does (percent output, the onboard position and velocity loops, encoder conversion and wrapping), so code written against SparkMotor runs on it unchanged.
+*/
+
+#pragma once
+
+#include <cmath>
+#include <FRL/motor/BaseMotor.hpp>
+#include <FRL/motor/PowerManager.hpp>
+#include "SimRegistry.hpp"
+
+
+/**
+ @version 1.0
+
+ * What a simulated motor is and what it's turning. Tune by altering them directly, same as PIDConstants.
+ * Inertia and Friction are everything the motor drives (gearbox, mechanism, wheel), as seen from the motor shaft: divide the mechanism's by the gear ratio squared.
+ */
+struct SimMotorConstants {
+    DCMotor motor {}; // NEO
+    double Inertia = 0.0005; // kg m²
+    double Friction = 0.0001; // Nm per rad/s
+    double SupplyVoltage = 12;
+};
+
+constexpr SimMotorConstants NEO_SIM {};
+constexpr SimMotorConstants NEO550_SIM { .motor = { .Kv = 917, .Resistance = 12.0 / 100 }, .Inertia = 0.0001 };
+
+
+/**
+ @version 1.0
+
+ * Simulated motor controller and motor. Satisfies MotorType and OnboardPositionMotor, so it drops into SwerveModule and Arm in place of SparkMotor.
+
+ * Physics runs in Step, which SimWorld calls; it's split into 1ms substeps, the same rate a Spark runs its onboard loops at.
+ * The motor is a brushed DC model: current is what's left of the applied voltage after back EMF, over the winding resistance, and torque is proportional to current.
+ * In coast with no output the bridge is open and no current flows; in brake it's shorted and back EMF brakes it.
+ * Smart current limits aren't modeled.
+
+ * Units match SparkMotor: GetPosition is motor rotations * the conversion factor, GetVelocity is RPM.
+
+ * Usage:
+ * SimMotor::ByID(2) -> SetConstants({ .Inertia = 0.002 });
+ * SimMotor::ByID(2) -> SetLoadTorque(-gravity);
+ */
+class SimMotor final : public BaseMotor, public SimRegistry<SimMotor> {
+    enum class Mode {
+        Percent,
+        Position,
+        Velocity
+    };
+
+    SimMotorConstants constants;
+
+    // Physical state, in the motor's own frame (not inverted)
+    double angle = 0; // Radians
+    double omega = 0; // Radians per second
+    double current = 0; // Amps, signed
+    double load = 0; // Nm from the outside world
+
+    // Controller state
+    Mode mode = Mode::Percent;
+    double percent = 0;
+    double setpoint = 0;
+    double applied = 0;
+    bool brake = false;
+    double P = 0;
+    double I = 0;
+    double D = 0;
+    double F = 0;
+    double integral = 0;
+    double lastError = 0;
+    double outMin = -1;
+    double outMax = 1;
+
+    // Encoder state
+    double factor = 1;
+    double offset = 0; // Rotations, added after inversion
+    bool wrapping = false;
+    double wrapMin = 0;
+    double wrapMax = 0;
+
+    double sign(){
+        return inversionState ? -1 : 1;
+    }
+
+    void setMode(Mode m){
+        if (m != mode){
+            integral = 0;
+            lastError = 0;
+        }
+        mode = m;
+    }
+
+    /**
+     * One tick of the emulated onboard loop. Like the Spark, I accumulates raw error and D is the change in error, both per 1ms loop.
+     */
+    double onboard(){
+        double error;
+        if (mode == Mode::Position){
+            error = setpoint - GetPosition();
+            if (wrapping){
+                error = std::remainder(error, wrapMax - wrapMin); // Short way round
+            }
+        }
+        else {
+            error = setpoint - GetVelocity();
+        }
+        integral += error;
+        double ret = P * error + I * integral + D * (error - lastError) + F * setpoint;
+        lastError = error;
+        return ret < outMin ? outMin : (ret > outMax ? outMax : ret);
+    }
+
+    void substep(double dt){
+        double output = mode == Mode::Percent ? percent : onboard();
+        output = output < -1 ? -1 : (output > 1 ? 1 : output);
+        applied = output;
+
+        double kt = 60 / (2 * M_PI * constants.motor.Kv); // Nm per amp, and volts per rad/s
+        if (output == 0 && !brake){
+            current = 0;
+        }
+        else {
+            current = (sign() * output * constants.SupplyVoltage - kt * omega) / constants.motor.Resistance;
+        }
+        double torque = kt * current - constants.Friction * omega + load;
+        omega += torque / constants.Inertia * dt; // Semi-implicit Euler: the new speed moves the angle
+        angle += omega * dt;
+    }
+
+public:
+    /**
+     * Seconds per physics substep
+     */
+    static constexpr double SubStep = 0.001;
+
+    /**
+     @param canID CAN id of the Spark this stands in for; SimMotor::ByID finds it again
+     @param motorConstants What the motor is and what it's turning
+     */
+    SimMotor(int canID, const SimMotorConstants& motorConstants = NEO_SIM) : SimRegistry { canID }, constants { motorConstants } {
+
+    }
+
+    void _setInverted(bool invert) {
+        // inversionState is all there is to it; sign() reads it
+    }
+
+    void SetPercent(double p){
+        setMode(Mode::Percent);
+        percent = p;
+    }
+
+    void SetP(double kP){
+        P = kP;
+    }
+
+    void SetI(double kI){
+        I = kI;
+    }
+
+    void SetD(double kD){
+        D = kD;
+    }
+
+    void SetF(double kF){
+        F = kF;
+    }
+
+    void SetOutputRange(double kPeakOF, double kPeakOR, double kNominalOF = 0, double kNominalOR = 0){
+        outMin = kPeakOR;
+        outMax = kPeakOF;
+    }
+
+    double GetPosition() {
+        return (sign() * angle / (2 * M_PI) + offset) * factor;
+    }
+
+    double GetVelocity() {
+        return sign() * omega * 60 / (2 * M_PI);
+    }
+
+    void SetPositionPID(double position){
+        setMode(Mode::Position);
+        setpoint = position;
+    }
+
+    void SetPositionConversionFactor(double f){
+        factor = f;
+    }
+
+    void SetEncoderPosition(double position){
+        offset = position / factor - sign() * angle / (2 * M_PI);
+    }
+
+    void SetPositionWrapping(double min, double max){
+        wrapping = true;
+        wrapMin = min;
+        wrapMax = max;
+    }
+
+    void SetSpeedPID(double speed){
+        setMode(Mode::Velocity);
+        setpoint = speed;
+    }
+
+    void ConfigIdleToBrake() {
+        brake = true;
+    }
+
+    double GetCurrent() {
+        return current < 0 ? -current : current;
+    }
+
+    /**
+     * Run the physics forward
+     @param dt Seconds; split into SubStep pieces
+     */
+    void Step(double dt){
+        int steps = (int)std::ceil(dt / SubStep - 1e-9);
+        steps = steps < 1 ? 1 : steps;
+        for (int i = 0; i < steps; i ++){
+            substep(dt / steps);
+        }
+    }
+
+    void SetConstants(const SimMotorConstants& motorConstants){
+        constants = motorConstants;
+    }
+
+    /**
+     * Torque the outside world puts on the shaft (gravity on an arm, say), in Nm in the motor's own frame. Stays until it's set again.
+     */
+    void SetLoadTorque(double torque){
+        load = torque;
+    }
+
+    /**
+     * Put the shaft somewhere, for setting up a run. Doesn't touch the encoder offset.
+     @param rotations Where the shaft is, in rotations, in the motor's own frame
+     @param rpm How fast it's going
+     */
+    void SetState(double rotations, double rpm = 0){
+        angle = rotations * 2 * M_PI;
+        omega = rpm * 2 * M_PI / 60;
+    }
+
+    /**
+     * Where the shaft really is, in rotations in the motor's own frame. What an absolute sensor on the mechanism sees, before the gearing.
+     */
+    double Rotations() const {
+        return angle / (2 * M_PI);
+    }
+
+    /**
+     * Output the controller is actually applying, -1 to 1, after the onboard loop
+     */
+    double Applied() const {
+        return applied;
+    }
+
+    /**
+     * Current this motor pulls from the battery, amps. Less than the motor current when it's not at full output.
+     */
+    double SupplyCurrent() const {
+        double i = current * applied;
+        return i < 0 ? -i : i;
+    }
+};
@@ -0,0 +1,66 @@
+/* Find simulated devices by CAN id or channel.
+    Simulated devices get constructed inside subsystems, same as real ones, so the simulation has no pointer to them. They put themselves on a list instead.
+*/
+
+#pragma once
+
+
+/**
+ @version 1.0
+
+ * Intrusive list of every live Device, keyed by id. Device inherits publicly from SimRegistry<Device>; each device type gets its own list,
+ * so a Spark and a CANCoder on the same CAN id don't collide, just like on the real bus. Nothing is allocated.
+ * Lists are per thread: a device can only be found from the thread that built it, so every thread can run its own simulation.
+ */
+template <typename Device>
+class SimRegistry {
+    inline static thread_local SimRegistry* head = 0;
+    SimRegistry* next = 0;
+
+protected:
+    int id;
+
+    SimRegistry(int deviceID) : id { deviceID } {
+        next = head;
+        head = this;
+    }
+
+    ~SimRegistry(){
+        for (SimRegistry** d = &head; *d; d = &((*d) -> next)){
+            if (*d == this){
+                *d = next;
+                break;
+            }
+        }
+    }
+
+public:
+    SimRegistry(const SimRegistry&) = delete; // The list points at this exact object
+    SimRegistry& operator=(const SimRegistry&) = delete;
+
+    /**
+     * The device with some id, or 0 if there isn't one
+     */
+    static Device* ByID(int deviceID){
+        for (SimRegistry* d = head; d; d = d -> next){
+            if (d -> id == deviceID){
+                return static_cast<Device*>(d);
+            }
+        }
+        return 0;
+    }
+
+    /**
+     * Call f on every live device
+     */
+    template <typename F>
+    static void ForEach(F f){
+        for (SimRegistry* d = head; d; d = d -> next){
+            f(*static_cast<Device*>(d));
+        }
+    }
+
+    int ID(){
+        return id;
+    }
+};
@@ -0,0 +1,226 @@
+/* Simulated sensors: stand-ins for CANCoder, frc::AnalogInput and frc::DigitalInput with the same calls the subsystems make.
+    Absolute encoders read a SimMotor's shaft through a gear ratio, so they agree with the physics without anyone updating them.
+*/
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <FRL/util/Clock.hpp>
+#include "SimMotor.hpp"
+#include "SimRegistry.hpp"
+
+
+/**
+ @version 1.0
+
+ * A 4096-tick absolute encoder on some mechanism. Attach it to the SimMotor that turns the mechanism and it follows the motor; otherwise it reads whatever Set gave it.
+ */
+class SimAbsoluteEncoder {
+    const SimMotor* motor = 0;
+    double ratio = 1;
+    double offset = 0;
+    double ticks = 0;
+
+public:
+    /**
+     * Follow a motor
+     @param m The motor turning the mechanism this is on
+     @param gearRatio Motor rotations per mechanism rotation
+     @param offsetTicks Where the encoder reads when the motor is at 0
+     */
+    void Attach(const SimMotor* m, double gearRatio, double offsetTicks = 0){
+        motor = m;
+        ratio = gearRatio;
+        offset = offsetTicks;
+    }
+
+    /**
+     * Stop following a motor and read this instead, in ticks
+     */
+    void Set(double t){
+        motor = 0;
+        ticks = t;
+    }
+
+    /**
+     * Position in ticks, 0 to 4096
+     */
+    double Ticks() const {
+        double t = motor ? motor -> Rotations() / ratio * 4096 + offset : ticks;
+        t = std::fmod(t, 4096);
+        return t < 0 ? t + 4096 : t;
+    }
+};
+
+
+/**
+ @version 1.0
+
+ * Simulated CANCoder; SwerveModule<..., SimCANCoder> uses it in place of the real one.
+ */
+class SimCANCoder : public SimAbsoluteEncoder, public SimRegistry<SimCANCoder> {
+public:
+    SimCANCoder(int canID) : SimRegistry { canID } {
+
+    }
+
+    double GetAbsolutePosition(){
+        return Ticks();
+    }
+
+    template <typename Frame>
+    void SetStatusFramePeriod(Frame frame, int periodMs, int timeoutMs = 0){
+        // Nothing on a simulated bus
+    }
+};
+
+
+/**
+ @version 1.0
+
+ * Simulated 12-bit analog input, for absolute encoders like the arm's. Keyed by channel.
+ */
+class SimAnalogInput : public SimAbsoluteEncoder, public SimRegistry<SimAnalogInput> {
+public:
+    SimAnalogInput(int channel) : SimRegistry { channel } {
+
+    }
+
+    int GetValue(){
+        return (int)Ticks() % 4096;
+    }
+
+    // The FPGA averaging calls OversampledEncoder makes. Values come back scaled by the oversample bits like the real thing; there's no accumulator
+    void SetOversampleBits(int bits){
+        oversampleBits = bits;
+    }
+
+    void SetAverageBits(int bits){
+
+    }
+
+    int GetAverageValue(){
+        return (int)(Ticks() * (1 << oversampleBits));
+    }
+
+    bool IsAccumulatorChannel(){
+        return false;
+    }
+
+    void InitAccumulator(){
+
+    }
+
+    void GetAccumulatorOutput(int64_t& value, int64_t& count){
+        value = 0;
+        count = 0;
+    }
+
+    static double GetSampleRate(){
+        return 50000;
+    }
+
+private:
+    int oversampleBits = 0;
+};
+
+
+class SimInterrupt;
+
+
+/**
+ @version 1.0
+
+ * Simulated digital input. Starts out true, which is what a real one reads with nothing pulling it low.
+ */
+class SimDigitalInput : public SimRegistry<SimDigitalInput> {
+    bool value = true;
+    SimInterrupt* interrupt = 0;
+
+    friend class SimInterrupt;
+
+public:
+    using Interrupt = SimInterrupt; // What InterruptInput uses in place of frc::AsynchronousInterrupt
+
+    SimDigitalInput(int channel) : SimRegistry { channel } {
+
+    }
+
+    bool Get(){
+        return value;
+    }
+
+    void Set(bool v);
+};
+
+
+/**
+ @version 1.0
+
+ * Simulated frc::AsynchronousInterrupt. There's no interrupt thread: the callback runs inside SimDigitalInput::Set, and edges are timestamped off Clock::Now().
+ */
+class SimInterrupt {
+    SimDigitalInput& source;
+    std::function<void(bool, bool)> callback;
+    bool rising = true; // AsynchronousInterrupt's defaults
+    bool falling = false;
+    bool enabled = false;
+    double risingTime = 0;
+    double fallingTime = 0;
+
+public:
+    SimInterrupt(SimDigitalInput& s, std::function<void(bool, bool)> c) : source { s }, callback { c } {
+        source.interrupt = this;
+    }
+
+    ~SimInterrupt(){
+        if (source.interrupt == this){
+            source.interrupt = 0;
+        }
+    }
+
+    void SetInterruptEdges(bool r, bool f){
+        rising = r;
+        falling = f;
+    }
+
+    void Enable(){
+        enabled = true;
+    }
+
+    void Disable(){
+        enabled = false;
+    }
+
+    double GetRisingTimestamp(){
+        return risingTime;
+    }
+
+    double GetFallingTimestamp(){
+        return fallingTime;
+    }
+
+    /**
+     * The input changed to level. Called by SimDigitalInput::Set.
+     */
+    void Edge(bool level){
+        if (!enabled){
+            return;
+        }
+        (level ? risingTime : fallingTime) = Clock::Now();
+        if (level ? rising : falling){
+            callback(level, !level);
+        }
+    }
+};
+
+
+inline void SimDigitalInput::Set(bool v){
+    bool changed = v != value;
+    value = v;
+    if (changed && interrupt){
+        interrupt -> Edge(v);
+    }
+}
@@ -0,0 +1,46 @@
+/* Runs a simulation: steps every SimMotor and moves SimClock forward, as fast as the host can go. */
+
+#pragma once
+
+#include <cmath>
+#include "SimClock.hpp"
+#include "SimMotor.hpp"
+
+
+/**
+ @version 1.0
+
+ * Steps everything simulated. There's no real time in here anywhere, so a match runs in however long the host takes to do the maths.
+
+ * Usage:
+ * SimClock::Install();
+ * SimWorld::Run(15, 0.02, [](){ robot.Synchronous(); }); // A whole auto period
+ */
+class SimWorld {
+public:
+    /**
+     * Step every SimMotor, then the clock
+     @param dt Seconds
+     */
+    static void Step(double dt){
+        SimMotor::ForEach([dt](SimMotor& motor){
+            motor.Step(dt);
+        });
+        SimClock::Advance(dt);
+    }
+
+    /**
+     * Call tick every period, stepping the world in between, for some amount of simulated time
+     @param seconds How long to run for
+     @param period Seconds between ticks; 0.02 for the robot loop
+     @param tick The control code
+     */
+    template <typename Tick>
+    static void Run(double seconds, double period, Tick tick){
+        long steps = std::lround(seconds / period);
+        for (long i = 0; i < steps; i ++){
+            tick();
+            Step(period);
+        }
+    }
+};
@@ -8,43 +8,78 @@
 #include <FRL/motor/BaseMotor.hpp>
 #include <ctre/Phoenix.h>
 #include <iostream>
+#include <algorithm>
 #include <FRL/motor/PIDController.hpp>
+#include <FRL/motor/HealthMonitor.hpp>
+#include <FRL/motor/PowerManager.hpp>
 #include <frc/smartdashboard/SmartDashboard.h>
 #include <FRL/util/vector.hpp>
-#include <frc/Timer.h>
+#include <FRL/util/Clock.hpp>
+
+/**
+ @version 1.0
+
+ * Everything needed to build a SwerveModule, as a literal type so a whole drivetrain can be described constexpr.
+ */
+struct SwerveModuleConfig {
+    int speedID;
+    int directionID;
+    int cancoderID;
+    short role;
+    double offset; // Encoder ticks
+    bool speedInverted = false;
+    bool direcInverted = false;
+    double steeringRatio = 0; // Direction motor rotations per wheel rotation (12.8 on an MK4). Nonzero runs steering on the motor controller; see EnableOnboardSteering.
+};
+
+/**
+ * Everything a SwerveModule reads off its hardware, in one go. See SwerveModule::Sense() and SwerveModule::Use().
+ */
+struct SwerveModuleReadings {
+    double speed; // Wheel motor velocity
+    double steering; // Direction motor encoder position (only means anything with onboard steering)
+    double cancoder; // CANCoder absolute position, raw
+    double speedCurrent;
+    double directionCurrent;
+};
 
 /**
  @author Luke White and Tyler Clarke
  @version 1.0
  
- * Swerve module for FRC. Manages 2 BaseMotor pointers (which because of the polymorphism can be any motor type in FRC)
+ * Swerve module for FRC. Owns its 2 motors, which can be any MotorType (SparkMotor, TalonFXMotor, or BaseMotor if you really need runtime polymorphism).
+
+ * The motor types are template parameters, so every motor call is a direct call.
+ * So is the absolute encoder's, which is what lets a simulation swap in SimMotor and SimCANCoder (see FRL/sim).
  */
+template <MotorType SpeedMotor, MotorType DirectionMotor, typename AbsoluteEncoder = CANCoder>
 class SwerveModule {
     /**
      * Motor that controls the rotation of the wheel
      */
-    BaseMotor* speed;
+    SpeedMotor speed;
     /**
      * Motor that controls the direction of the wheel
      */
-    BaseMotor* direction;
+    DirectionMotor direction;
     /**
      * PIDController that manages the direction motor
      */
-    PIDController<BaseMotor>* directionController;
+    PIDController<DirectionMotor> directionController { &direction };
     /**
      * PIDController that manages the speed motor
      */
-    PIDController<BaseMotor>* speedController;
+    PIDController<SpeedMotor> speedController { &speed };
     /**
-     * CANCoder to use for PID; heap allocated by an ID provided on construction.
+     * CANCoder to use for PID; constructed in place from an ID provided on construction.
      */
-    CANCoder* cancoder;
+    AbsoluteEncoder cancoder;
 
     /**
      * Current percentage that will be applied to the wheel
      */
     double curPercent; // So multiple commands can alter speed
+    double lastPercent = 0; // What ApplySpeed last sent, before scaling
        
     /**
      * SwerveModules are a linked list! This means you can have any number of 'em configured with separate offsets and command them all at once with a single call.
@@ -61,46 +96,212 @@ class SwerveModule {
      */
     double encoderOffset;
 
+    /**
+     * The last snapshot from Use()
+     */
+    SwerveModuleReadings readings;
+
+    /**
+     * Whether steering runs on the direction motor's own controller instead of directionController
+     */
+    bool onboardSteering = false;
+
+    /**
+     * Output multiplier for the wheel motor, from SetOutputScale
+     */
+    double speedScale = 1;
+    double directionScale = 1;
+
+    /**
+     * Output multiplier onboard steering was last configured with, so the Spark only gets told when it changes
+     */
+    double onboardDirectionScale = 1;
+
+    /**
+     * Whether Use() has handed us a snapshot. Until it has, the getters read the hardware themselves.
+     */
+    bool sensed = false;
+
+    /**
+     * Where the CANCoder says the wheel is pointing, in ticks, without the 180 flip GetDirection applies
+     */
+    double physicalDirection(){
+        return smartLoop((sensed ? readings.cancoder : cancoder.GetAbsolutePosition()) - encoderOffset);
+    }
+
+    /**
+     * Steer with the motor controller's loop. The controller doesn't know about the 180 flip, so the target is turned back into a physical one here.
+     */
+    void setOnboardDirection(double targetPos) requires OnboardPositionMotor<DirectionMotor> {
+        double target = smartLoop(targetPos - (speed.inversionState ? 2048 : 0));
+        double physical = physicalDirection();
+        if (std::abs(loopize(target, physical, 4096)) < 20 && std::abs(loopize(physical, smartLoop(sensed ? readings.steering : direction.GetPosition()), 4096)) > OnboardDriftLimit){
+            SeedSteering(); // The wheel's settled and the motor encoder disagrees with the CANCoder, so it slipped or missed counts
+        }
+        direction.SetPositionPID(target);
+    }
+
     float lockTime = -1; // Don't ever lock
     double lockStart = -1; // Time that it decided locking was necessary
     
     bool locked = false;
 public:
+    /**
+     * What the module reads off its motors. Speed PID wants wheel velocity every tick; steering runs off the CANCoder, so the direction motor only has to report current for the HealthMonitor.
+     */
+    static constexpr StatusNeeds SpeedStatus = StatusNeeds { .velocityMs = LOOP_PERIOD_MS } | HealthMonitorStatus;
+    static constexpr StatusNeeds DirectionStatus = HealthMonitorStatus;
+
+    /**
+     * With onboard steering, the direction motor's position is only read for drift checks, which can be slow.
+     */
+    static constexpr StatusNeeds OnboardDirectionStatus = StatusNeeds { .positionMs = 100 } | HealthMonitorStatus;
+
+    /**
+     * How far (in ticks) the direction motor's encoder can drift from the CANCoder before it gets re-seeded
+     */
+    static constexpr double OnboardDriftLimit = 40;
+
+    /**
+     * What a module built from some config will read off its direction motor
+     */
+    static constexpr StatusNeeds DirectionStatusFor(const SwerveModuleConfig& config){
+        return config.steeringRatio != 0 ? OnboardDirectionStatus : DirectionStatus;
+    }
+
+    /**
+     * CANCoder frames per second: sensor data every tick, and the default 100ms battery/faults frame.
+     */
+    static constexpr double CANCoderFramesPerSecond = 1000.0 / LOOP_PERIOD_MS + 1000.0 / 100;
+
+    using Readings = SwerveModuleReadings;
+
     short swerveRole;
     bool readyToOrient = false;
 
     /**
      * Constructor
-     @param speedMotor The motor to use for wheel speed control
-     @param directionMotor The motor to use for wheel direction control
+     @param speedID The CAN id of the motor to use for wheel speed control
+     @param directionID The CAN id of the motor to use for wheel direction control
      @param CanCoderID The CAN id of the CANCoder
      @param offset The offset of the wheel, in encoder ticks
      @param speedInverted Whether or not to invert the wheel speed motor
      @param direcInverted Whether or not to invert the wheel direction motor
      */
-    SwerveModule(BaseMotor* speedMotor, BaseMotor* directionMotor, int CanCoderID, short role, double offset, bool speedInverted=false, bool direcInverted=false) {
+    SwerveModule(int speedID, int directionID, int CanCoderID, short role, double offset, bool speedInverted=false, bool direcInverted=false) : speed { speedID }, direction { directionID }, cancoder { CanCoderID } {
         encoderOffset = offset;
-        speed = speedMotor;
-        direction = directionMotor;
-        cancoder = new CANCoder {CanCoderID};
         
         swerveRole = role;
-        directionController = new PIDController<BaseMotor> (direction);
-        speedController = new PIDController<BaseMotor> (speed);
-        directionController -> constants.P = 0.0005;
-        //directionController -> constants.I = 0.0001;
-        directionController -> constants.MaxOutput = 0.2;
-        directionController -> constants.MinOutput = -0.2;
-        directionController -> SetCircumference(4096);
+        directionController.constants.P = 0.0005;
+        //directionController.constants.I = 0.0001;
+        directionController.constants.MaxOutput = 0.2;
+        directionController.constants.MinOutput = -0.2;
+        directionController.SetCircumference(4096);
+
+        speedController.constants.P = 0.005;
+        speedController.constants.D = 0.0015;
 
-        speedController -> constants.P = 0.005;
-        speedController -> constants.D = 0.0015;
+        speed.SetInverted(speedInverted);
+        direction.SetInverted(direcInverted);
 
-        speed -> SetInverted(speedInverted);
-        direction -> SetInverted(direcInverted);
+        speed.SetStatusFrames(SpeedStatus);
+        direction.SetStatusFrames(DirectionStatus);
+        cancoder.SetStatusFramePeriod(CANCoderStatusFrame_SensorData, LOOP_PERIOD_MS); // Default is 10ms; we only look every 20
 
-        //speed -> ConfigIdleToBrake();
-        //direction -> ConfigIdleToBrake();
+        //speed.ConfigIdleToBrake();
+        //direction.ConfigIdleToBrake();
+    }
+
+    /**
+     * Construct from a SwerveModuleConfig (see constants.h)
+     @param config IDs, role and offset of the module
+     */
+    SwerveModule(const SwerveModuleConfig& config) : SwerveModule(config.speedID, config.directionID, config.cancoderID, config.role, config.offset, config.speedInverted, config.direcInverted) {
+        if constexpr (OnboardPositionMotor<DirectionMotor>){
+            if (config.steeringRatio != 0){
+                EnableOnboardSteering(config.steeringRatio);
+            }
+        }
+    }
+
+    /**
+     * Run steering on the direction motor's controller (a Spark's 1kHz position loop) instead of directionController on the RoboRIO.
+     * The motor encoder is seeded from the CANCoder, and re-seeded whenever they drift apart; SetDirection then just sends setpoints.
+     @param steeringRatio Direction motor rotations per wheel rotation
+     */
+    void EnableOnboardSteering(double steeringRatio) requires OnboardPositionMotor<DirectionMotor> {
+        direction.SetPositionConversionFactor(4096 / steeringRatio); // Encoder reads in CANCoder ticks
+        direction.SetPositionWrapping(0, 4096); // Short way round, same as directionController's circumference
+        direction.SetP(directionController.constants.P); // Same gains to start with; tune on the robot
+        direction.SetI(directionController.constants.I);
+        direction.SetD(directionController.constants.D);
+        direction.SetOutputRange(directionController.constants.MaxOutput, directionController.constants.MinOutput);
+        direction.SetStatusFrames(OnboardDirectionStatus);
+        SeedSteering();
+        onboardSteering = true;
+    }
+
+    /**
+     * Copy the CANCoder's absolute position into the direction motor's encoder
+     */
+    void SeedSteering() requires OnboardPositionMotor<DirectionMotor> {
+        direction.SetEncoderPosition(physicalDirection());
+    }
+
+    /**
+     * Read all of this module's sensors. Only touches the hardware, so it's safe to call from a sensor thread (see SensorThread).
+     * Doesn't follow the link; every module gets sensed separately.
+     */
+    Readings Sense(){
+        return { speed.GetVelocity(), direction.GetPosition(), cancoder.GetAbsolutePosition(), speed.GetCurrent(), direction.GetCurrent() };
+    }
+
+    /**
+     * Hand the module a snapshot from Sense(). From then on it works off snapshots and never reads the hardware in the control loop.
+     */
+    void Use(const Readings& r){
+        readings = r;
+        sensed = true;
+    }
+
+    /**
+     * How much current this module would draw at full (unscaled) output, going by last tick's wheel command. For PowerManager. Doesn't follow the link.
+     * The wheel motor is predicted from the command and its speed; the direction motor just from what it's drawing, unscaled.
+     @param voltage Battery voltage
+     @param motor Wheel motor model
+     */
+    double Demand(double voltage, const DCMotor& motor = {}){
+        double direcCurrent = sensed ? readings.directionCurrent : direction.GetCurrent();
+        return motor.Current(lastPercent, GetSpeed(), voltage) + direcCurrent / std::max(directionScale, 0.1);
+    }
+
+    /**
+     * The steering PIDController's constants, for tuning (see src/tune)
+     */
+    PIDConstants& DirectionConstants(){
+        return directionController.constants;
+    }
+
+    PIDConstants& SpeedConstants(){
+        return speedController.constants;
+    }
+
+    /**
+     * Scale this module's motor outputs down, for derating (see HealthMonitor) or power budgeting. Doesn't follow the link.
+     @param speedScale Multiplier on the wheel motor, 0-1
+     @param directionScale Multiplier on the direction motor, 0-1
+     */
+    void SetOutputScale(double speedScale, double directionScale){
+        this -> speedScale = speedScale;
+        this -> directionScale = directionScale;
+        speedController.outputScale = speedScale;
+        directionController.outputScale = directionScale;
+        if constexpr (OnboardPositionMotor<DirectionMotor>){
+            if (onboardSteering && std::abs(directionScale - onboardDirectionScale) > 0.05){ // It's a config write; don't spam it
+                onboardDirectionScale = directionScale;
+                direction.SetOutputRange(directionController.constants.MaxOutput * directionScale, directionController.constants.MinOutput * directionScale);
+            }
+        }
     }
 
     void SetLockTime(float lT, bool followLink = true){
@@ -123,11 +324,11 @@ public:
      * Get the current (physical) direction of the module
      */
     long GetDirection() {
-        if (speed -> inversionState){
-            return smartLoop(2048 + (cancoder -> GetAbsolutePosition() - encoderOffset));
+        if (speed.inversionState){
+            return smartLoop(2048 + physicalDirection());
         }
         else{
-            return smartLoop(cancoder -> GetAbsolutePosition() - encoderOffset);
+            return physicalDirection();
         }
     }
 
@@ -165,11 +366,18 @@ public:
             return;
         }
         if (std::abs(loopize(targetPos, GetDirection(), 4096)) > 1524){ // All turns >90 degrees can be optimized with 180 reversion logic.
-            speed -> SetInverted();
+            speed.SetInverted();
         }
 
-        directionController -> SetPosition(targetPos);
-        directionController -> Update(GetDirection());
+        if (onboardSteering){
+            if constexpr (OnboardPositionMotor<DirectionMotor>){
+                setOnboardDirection(targetPos);
+            }
+        }
+        else{
+            directionController.SetPosition(targetPos);
+            directionController.Update(GetDirection());
+        }
 
         if (isLinked && followLink){
             linkSwerve -> SetDirection(targetPos);
@@ -177,8 +385,8 @@ public:
     }
 
     void SetSpeed(double targetSpeed, bool followLink = true){
-        speedController -> SetSpeed(targetSpeed);
-        speedController -> Update(GetSpeed());
+        speedController.SetSpeed(targetSpeed);
+        speedController.Update(GetSpeed());
 
         if (isLinked && followLink){
             linkSwerve -> SetSpeed(targetSpeed);
@@ -202,14 +410,15 @@ public:
      */
     void ApplySpeed(){
         locked = false;
-        speed -> SetPercent(curPercent);
+        speed.SetPercent(curPercent * speedScale);
+        lastPercent = curPercent;
 
         if (lockTime != -1){
             if (curPercent == 0) { // If nothin' done been did
                 if (lockStart == -1){
-                    lockStart = (double)frc::Timer::GetFPGATimestamp();
+                    lockStart = Clock::Now();
                 }
-                if ((double)frc::Timer::GetFPGATimestamp() - lockStart > lockTime){
+                if (Clock::Now() - lockStart > lockTime){
                     Lock(false); // locking is done on a per-module basis
                     locked = true;
                 }
@@ -309,7 +518,7 @@ public:
         }
         if (translation.isZero() && rotation.isZero()){
             if (!locked){
-                direction -> SetPercent(0); // Just stop movin' direction
+                direction.SetPercent(0); // Just stop movin' direction
             }
             return; // Don't do nothin' - it'll all sort itself out
         }
@@ -354,13 +563,13 @@ public:
     bool Orient(double current, double angle, bool tuba){
         if (angle == -1){
             iState = 0;
-            lastTime = (double)frc::Timer::GetFPGATimestamp();
+            lastTime = Clock::Now();
             return false;
         }
         if (lastTime == -1){
-            lastTime = (double)frc::Timer::GetFPGATimestamp();
+            lastTime = Clock::Now();
         }
-        double secsElapsed = (double)frc::Timer::GetFPGATimestamp() - lastTime;
+        double secsElapsed = Clock::Now() - lastTime;
         current = smartLoop(current, 360);
         angle = smartLoop(angle, 360);
         frc::SmartDashboard::PutNumber("current", current);
@@ -395,7 +604,7 @@ public:
     }
 
     double GetSpeed(){
-        return speed -> GetVelocity();
+        return sensed ? readings.speed : speed.GetVelocity();
     }
 
     double GetAverageLinkSpeed(){
@@ -411,6 +620,34 @@ public:
         return totes/cnt;
     }
 
+    /**
+     * Get this module's wheel velocity as a vector, in the same frame SetToVector takes (angle in radians from the direction encoder).
+     * Units are whatever the speed motor reports; scale it yourself.
+     */
+    vector GetVelocity(){
+        vector ret;
+        ret.setMandA(GetSpeed(), GetDirection() * PI/2048);
+        return ret;
+    }
+
+    /**
+     * Average wheel velocity of this and every linked module. Rotation cancels out, so this is how the robot itself is moving.
+     */
+    vector GetAverageLinkVelocity(){
+        vector totes;
+        int cnt = 0;
+        SwerveModule* link = this;
+        while (true){
+            totes += link -> GetVelocity();
+            cnt ++;
+            if (!link -> isLinked){
+                break;
+            }
+            link = link -> linkSwerve;
+        }
+        return { totes.x / cnt, totes.y / cnt };
+    }
+
     //bool orientTo(double target, double curr) {
         
     //}
@@ -0,0 +1,45 @@
+/* Debug check that the control path never touches the heap.
+    Everything is built at boot (see constants.h); after that, an allocation between reading the inputs and commanding the motors is a bug - it's slow and it can fail.
+*/
+
+#pragma once
+
+
+/**
+ @version 1.0
+
+ * While one of these is alive, any operator new on the same thread is reported, and by default aborts the program.
+ * The robot modes hold one over their control path (see TeleopMode::Synchronous), and publish telemetry after it's gone:
+ * SmartDashboard allocates on a new key's first Put, and std::cout can too, so neither belongs inside one.
+
+ * Only does anything in builds with FRL_ALLOCATION_GUARD defined (debug builds; see build.gradle), where AllocationGuard.cpp replaces the global operator new (every form: plain, array, nothrow and aligned).
+ * In every other build it's an empty object and costs nothing.
+ * It's per thread, so the vision thread, NetworkTables and friends can allocate all they like.
+ */
+class AllocationGuard {
+public:
+    /**
+     * How many guards are alive on this thread
+     */
+    inline static thread_local int depth = 0;
+
+    /**
+     * Abort on a guarded allocation (true), or just print it and carry on (false), for hunting down several at once.
+     */
+    inline static bool Fatal = true;
+
+    AllocationGuard(){
+        depth ++;
+    }
+
+    ~AllocationGuard(){
+        depth --;
+    }
+
+    AllocationGuard(const AllocationGuard&) = delete;
+    AllocationGuard& operator=(const AllocationGuard&) = delete;
+
+    static bool Armed(){
+        return depth > 0;
+    }
+};
@@ -0,0 +1,37 @@
+/* The one clock everything in FRL reads.
+    On the robot it's the FPGA timestamp. Anything else (a simulation, mostly) can swap its own in, and then time is whatever it says.
+*/
+
+#pragma once
+
+#include <frc/Timer.h>
+
+
+/**
+ @version 1.0
+
+ * Injectable clock. Read it with Clock::Now() instead of going to frc::Timer directly.
+ * Clock::Use(source) makes Now() call source instead; Clock::Use(0) goes back to the FPGA.
+ */
+class Clock {
+    inline static double (*source)() = 0;
+
+public:
+    /**
+     * Seconds, from whatever clock is in use
+     */
+    static double Now(){
+        if (source){
+            return source();
+        }
+        return (double)frc::Timer::GetFPGATimestamp();
+    }
+
+    /**
+     * Swap in a different clock
+     @param s Function returning the time in seconds, or 0 for the FPGA clock
+     */
+    static void Use(double (*s)()){
+        source = s;
+    }
+};
@@ -0,0 +1,126 @@
+/* Trig that works at compile time.
+    <cmath> isn't constexpr until C++26. These are, and at runtime they're just the <cmath> calls, so there's no cost to using them everywhere.
+*/
+
+#pragma once
+
+#include <cmath>
+#include <type_traits>
+
+
+namespace cexpr {
+
+constexpr double pi = 3.14159265358979323846;
+
+constexpr double floor(double x){
+    if (std::is_constant_evaluated()){
+        long long i = (long long)x;
+        return (double)i > x ? i - 1 : i;
+    }
+    return std::floor(x);
+}
+
+constexpr double sqrt(double x){
+    if (std::is_constant_evaluated()){
+        if (x <= 0){
+            return 0;
+        }
+        double r = x > 1 ? x : 1;
+        for (int i = 0; i < 100; i ++){ // Newton's method; converges long before this
+            double next = (r + x / r) / 2;
+            if (next == r){
+                break;
+            }
+            r = next;
+        }
+        return r;
+    }
+    return std::sqrt(x);
+}
+
+/**
+ * Wrap an angle into [0, round). No loops, unlike smartLoop.
+ */
+constexpr double wrap(double angle, double round = 2 * pi){
+    return angle - round * floor(angle / round);
+}
+
+constexpr double sin(double x){
+    if (std::is_constant_evaluated()){
+        x = wrap(x + pi) - pi; // -pi to pi
+        double term = x;
+        double sum = x;
+        for (int n = 1; n < 20; n ++){ // Taylor series
+            term *= -x * x / ((2 * n) * (2 * n + 1));
+            sum += term;
+        }
+        return sum;
+    }
+    return std::sin(x);
+}
+
+constexpr double cos(double x){
+    if (std::is_constant_evaluated()){
+        return sin(x + pi / 2);
+    }
+    return std::cos(x);
+}
+
+constexpr double atan(double x){
+    if (std::is_constant_evaluated()){
+        if (x < 0){
+            return -atan(-x);
+        }
+        if (x > 1){
+            return pi / 2 - atan(1 / x);
+        }
+        x = x / (1 + sqrt(1 + x * x)); // Half the angle, so the series converges fast
+        double term = x;
+        double sum = x;
+        for (int n = 1; n < 30; n ++){
+            term *= -x * x;
+            sum += term / (2 * n + 1);
+        }
+        return 2 * sum;
+    }
+    return std::atan(x);
+}
+
+constexpr double atan2(double y, double x){
+    if (std::is_constant_evaluated()){
+        if (x > 0){
+            return atan(y / x);
+        }
+        if (x < 0){
+            return atan(y / x) + (y < 0 ? -pi : pi);
+        }
+        return y > 0 ? pi / 2 : (y < 0 ? -pi / 2 : 0);
+    }
+    return std::atan2(y, x);
+}
+
+/**
+ * atan2 to within 4e-8 radians (about 1/2000 of an encoder tick), with no branches and no library call: a polynomial fitted to atan on 0-1, and selects to get the other octants.
+ * Several times quicker than std::atan2, which works to the last bit.
+ */
+constexpr double atan2Fast(double y, double x){
+    double ax = x < 0 ? -x : x;
+    double ay = y < 0 ? -y : y;
+    double big = ax > ay ? ax : ay;
+    double a = (ax < ay ? ax : ay) / (big > 0 ? big : 1);
+    double t = a * a;
+    double r = a * (0.9999993356533445 + t * (-0.3332986078944186 + t * (0.19946564218028046 + t * (-0.1390861822029385
+        + t * (0.09642161731171352 + t * (-0.05591178079535322 + t * (0.02186255052873728 + t * -0.004054448831593305)))))));
+    r = ay > ax ? pi / 2 - r : r;
+    r = x < 0 ? pi - r : r;
+    return y < 0 ? -r : r;
+}
+
+/**
+ * acos, as atan2 so it's well behaved right up to the ends of its range
+ */
+constexpr double acos(double x){
+    return atan2(sqrt(1 - x * x), x);
+}
+
+}
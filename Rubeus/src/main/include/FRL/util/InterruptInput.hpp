@@ -0,0 +1,114 @@
+/* Interrupt-driven digital inputs.
+    The FPGA watches the pin and timestamps every edge; a thread wakes up for each one, latches the new level, and calls a handler straight away.
+    Limit switches and beam breaks get acted on microseconds after they change, not whenever the next loop gets round to polling them.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <frc/AsynchronousInterrupt.h>
+
+
+/**
+ * Which interrupt goes with an input: frc::AsynchronousInterrupt, unless the input names its own (SimDigitalInput does).
+ */
+template <typename Input>
+struct InterruptFor {
+    using type = frc::AsynchronousInterrupt;
+};
+
+template <typename Input> requires requires { typename Input::Interrupt; }
+struct InterruptFor<Input> {
+    using type = typename Input::Interrupt;
+};
+
+
+/**
+ @version 1.0
+
+ * A digital input with an edge interrupt on it, both edges. Each edge latches the level and the FPGA's timestamp for it, then calls the handler given to Start.
+
+ * The handler runs on the interrupt's thread, not the main loop's. Keep it short (stop a motor, set a flag) and only touch things that are fine being touched from another thread.
+ * If it stops a motor the main loop also drives, have it latch an atomic flag too, so the loop doesn't drive it straight back.
+
+ * Input is frc::DigitalInput, or anything with the same calls (SimDigitalInput).
+
+ * Usage:
+ * InterruptInput <frc::DigitalInput> limit { 0 };
+ * limit.Start([this](bool level){ hit = level; if (level) motor.SetPercent(0); }); // once, when everything the handler touches exists. hit is a std::atomic<bool> the loop checks
+ * if (limit.Level()) ... // latched, so no hardware read
+ */
+template <typename Input>
+class InterruptInput {
+    Input input;
+    std::function<void(bool)> handler;
+    std::atomic<bool> level = false;
+    std::atomic<double> lastEdge = 0;
+    std::atomic<uint32_t> edges = 0;
+    bool started = false;
+    typename InterruptFor<Input>::type interrupt; // Last, so it's destroyed (and its thread stopped) before anything it calls into
+
+    void edge(bool rising, bool falling){
+        bool now = rising != falling ? rising : input.Get(); // Both at once means it bounced; go by where it ended up
+        double risingTime = rising ? (double)interrupt.GetRisingTimestamp() : 0;
+        double fallingTime = falling ? (double)interrupt.GetFallingTimestamp() : 0;
+        level = now;
+        lastEdge = risingTime > fallingTime ? risingTime : fallingTime;
+        edges ++;
+        if (handler){
+            handler(now);
+        }
+    }
+
+public:
+    InterruptInput(int channel) : input { channel }, interrupt { input, [this](bool rising, bool falling){ edge(rising, falling); } } {
+        interrupt.SetInterruptEdges(true, true);
+    }
+
+    InterruptInput(const InterruptInput&) = delete; // The interrupt holds on to this
+
+    /**
+     * Start listening
+     @param onEdge Called with the new level on every edge, on the interrupt thread. Optional
+     */
+    void Start(std::function<void(bool)> onEdge = {}){
+        handler = onEdge;
+        interrupt.Enable();
+        level = input.Get(); // After Enable, so nothing gets in between unnoticed
+        started = true;
+    }
+
+    /**
+     * The level as of the last edge. Before Start, reads the input.
+     */
+    bool Level(){
+        return started ? level.load() : input.Get();
+    }
+
+    /**
+     * Read the input itself
+     */
+    bool Get(){
+        return input.Get();
+    }
+
+    /**
+     * When the last edge happened, seconds on the FPGA clock (Clock::Now() on the robot); 0 if there hasn't been one
+     */
+    double LastEdge() const {
+        return lastEdge;
+    }
+
+    /**
+     * How many edges there have been. Lots more than the thing has actually moved means the switch bounces.
+     */
+    uint32_t Edges() const {
+        return edges;
+    }
+
+    Input& Raw(){
+        return input;
+    }
+};
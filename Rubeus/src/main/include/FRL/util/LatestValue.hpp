@@ -0,0 +1,64 @@
+/* Lock-free "latest value" slot for handing data from one thread to another.
+    The writer never waits and the reader never waits; the reader just gets whatever was published last.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+
+/**
+ @version 1.0
+
+ * Triple buffer. One thread publishes, one thread reads; neither ever blocks, and old values are simply skipped.
+
+ * The writer fills its own buffer and swaps it into the middle; the reader swaps the middle out into its own buffer.
+ * The only shared thing is one atomic byte, so there's no lock for a thread to get stuck holding (see the pthread_cancel notes in AwesomeRobotBase).
+
+ * Every value carries a timestamp, so the reader knows how old it is.
+ * ONLY ONE WRITER THREAD AND ONE READER THREAD! Two of either will trample each other.
+ */
+template <typename T>
+class LatestValue {
+    struct Slot {
+        double time = -1;
+        T value {};
+    };
+
+    static constexpr uint8_t FRESH = 4; // Set on the middle index when it has something the reader hasn't seen
+    static constexpr uint8_t INDEX = 3;
+
+    Slot slots[3];
+    std::atomic<uint8_t> middle { 1 };
+    uint8_t back = 0; // Writer's buffer
+    uint8_t front = 2; // Reader's buffer
+
+public:
+    /**
+     * Publish a new value. Writer thread only.
+     @param time Timestamp of the value
+     @param value The value
+     */
+    void Publish(double time, const T& value){
+        slots[back].time = time;
+        slots[back].value = value;
+        back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    /**
+     * Get the newest value, if there's one we haven't read yet. Reader thread only.
+     * Returns false (and leaves value and time alone) if nothing new was published since the last Read.
+     @param value Gets the value
+     @param time Gets its timestamp
+     */
+    bool Read(T& value, double& time){
+        if (!(middle.load(std::memory_order_acquire) & FRESH)){
+            return false;
+        }
+        front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+        value = slots[front].value;
+        time = slots[front].time;
+        return true;
+    }
+};
@@ -0,0 +1,136 @@
+/* Oversampled, filtered analog absolute encoders.
+    Lets the FPGA do the averaging (oversample and average bits, and the accumulator where the channel has one), then smooths what's left
+    with a small fixed-point filter. Sampled by one thread, once per sensor poll; everything else works off what that thread hands on.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <FRL/util/Clock.hpp>
+
+
+/**
+ @version 1.0
+
+ * A 4096-tick analog absolute encoder, read through the FPGA's averaging and a fixed-point low-pass filter.
+
+ * Each Sample takes the mean of everything the FPGA measured since the last one: off the accumulator if the channel has one (on the RIO, analog 0 and 1),
+ * else the FPGA's latest averaged value. That goes into a first-order filter (y += (x - y) / 2^FilterShift) in 16.16 fixed point,
+ * wrap-aware so it goes the short way round through 0. An average taken across 0 is nonsense (some 4095s, some 0s), so within NearWrap of 0 it uses
+ * the plain single sample instead, and readings that jump impossibly far anyway are held off for a couple of polls.
+
+ * Input is frc::AnalogInput, or anything with the same calls (SimAnalogInput).
+
+ * Usage:
+ * OversampledEncoder <frc::AnalogInput> encoder { 0 };
+ * double ticks = encoder.Sample(); // once per poll, always on the same thread (on the robot, the SensorThread; see Arm::Sense)
+ * double cached = encoder.GetValue(); // that thread only; hand ticks on to anything else (see Arm::Use)
+ */
+template <typename Input>
+class OversampledEncoder {
+    static constexpr int64_t One = 1 << 16; // 16.16 fixed point
+    static constexpr int64_t Circle = 4096 * One;
+
+    Input input;
+    bool accumulating;
+    int64_t lastSum = 0;
+    int64_t lastCount = 0;
+    int64_t state = -1; // Filtered ticks, 16.16; -1 until the first Sample
+    double lastTime = 0;
+    std::atomic<double> period = 0; // Seconds between the last two Samples: the sensor poll period. Atomic, as GroupDelay gets read from other threads
+    int rejected = 0; // Samples in a row thrown out by the WrapGuard check
+
+public:
+    static constexpr int OversampleBits = 2; // FPGA sums 2^OversampleBits samples...
+    static constexpr int AverageBits = 4; // ...then averages 2^AverageBits of those: one value per 64 samples
+    static constexpr int FilterShift = 1; // Filter weight on each new sample is 1 / 2^FilterShift
+    static constexpr double NearWrap = 64; // Ticks either side of 0 where averages can't be trusted
+    static constexpr double WrapGuard = 256; // Ticks. A reading this far off the last means something went through 0, not that the arm moved that far in one poll
+    static constexpr int MaxRejected = 2; // After this many WrapGuard rejections in a row, believe it: the encoder really did jump
+
+    OversampledEncoder(int channel) : input { channel } {
+        input.SetOversampleBits(OversampleBits);
+        input.SetAverageBits(AverageBits);
+        accumulating = input.IsAccumulatorChannel();
+        if (accumulating){
+            input.InitAccumulator();
+            input.GetAccumulatorOutput(lastSum, lastCount);
+        }
+    }
+
+    /**
+     * Take a reading. Only ever call it from one thread (it isn't safe against itself), once per poll: on the robot that's the SensorThread, every 5 ms (see Arm::Sense).
+     * The filter's time constant is in polls, so the poll rate sets it; GroupDelay measures the rate rather than assuming one.
+     @returns The filtered position in ticks, 0 to 4096, with fractions
+     */
+    double Sample(){
+        double latest = (double)input.GetAverageValue() / (1 << OversampleBits);
+        double mean = latest;
+        if (accumulating){
+            int64_t sum, count;
+            input.GetAccumulatorOutput(sum, count);
+            if (count > lastCount){
+                mean = (double)(sum - lastSum) / (count - lastCount) / (1 << OversampleBits);
+            }
+            lastSum = sum;
+            lastCount = count;
+            if (std::abs(mean - latest) > WrapGuard){ // The poll's mean went through 0; the latest value might not have
+                mean = latest;
+            }
+        }
+        double previous = GetValue();
+        if (latest < NearWrap || latest > 4096 - NearWrap || (state >= 0 && (previous < NearWrap || previous > 4096 - NearWrap))){
+            mean = input.GetValue(); // One sample can't straddle 0
+        }
+        int64_t x = std::llround(mean * One) % Circle;
+        if (state < 0){
+            state = x;
+        }
+        else {
+            int64_t diff = x - state;
+            if (diff >= Circle / 2){ // Short way round
+                diff -= Circle;
+            }
+            else if (diff < -Circle / 2){
+                diff += Circle;
+            }
+            if (std::abs(diff) > WrapGuard * One && rejected < MaxRejected){ // Even the FPGA's own average went through 0; hold for a poll
+                rejected ++;
+            }
+            else {
+                rejected = 0;
+                state += diff / (1 << FilterShift); // Division, not >>, so negative steps round the same way as positive ones
+                state = (state % Circle + Circle) % Circle;
+            }
+        }
+        double now = Clock::Now();
+        period = lastTime ? now - lastTime : 0;
+        lastTime = now;
+        return GetValue();
+    }
+
+    /**
+     * The last Sample's result, in ticks. Same thread as Sample only.
+     */
+    double GetValue() const {
+        return state < 0 ? 0 : (double)state / One;
+    }
+
+    /**
+     * How far behind the real position GetValue is, in seconds, for slow motion: half the FPGA's averaging window,
+     * plus half the accumulator's (one poll), plus the filter's (2^FilterShift - 1 polls). The poll period is the measured time between the last two Samples,
+     * not the control loop's. Safe from any thread.
+     */
+    double GroupDelay() const {
+        double fpga = ((1 << (OversampleBits + AverageBits)) - 1) / (2 * Input::GetSampleRate());
+        double poll = period;
+        double accumulator = accumulating ? poll / 2 : 0;
+        return fpga + accumulator + ((1 << FilterShift) - 1) * poll;
+    }
+
+    Input& Raw(){
+        return input;
+    }
+};
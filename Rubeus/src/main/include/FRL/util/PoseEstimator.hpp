@@ -0,0 +1,208 @@
+/* Extended Kalman filter for a field pose (x, y, heading).
+    Wheel odometry drives the prediction; gyro and vision are measurements.
+*/
+
+#pragma once
+
+#include <cmath>
+#include <FRL/util/vector.hpp>
+
+
+/**
+ @version 1.0
+
+ * Noise constants for PoseEstimator. All standard deviations, in meters/radians/seconds.
+ * Tune by altering them directly, same as PIDConstants.
+ */
+struct PoseEstimatorConstants {
+    double WheelStdDev = 0.15; // Wheel velocity noise (m/s). Slippage lives here.
+    double HeadingDriftStdDev = 0.02; // Heading random walk (rad/s)
+    double GyroStdDev = 0.01; // Heading measurement noise (rad)
+    double VisionStdDev = 0.05; // Position noise of a head-on, unambiguous tag 1 meter away (m)
+    double VisionDistanceGain = 0.3; // Noise grows with distance squared; this is how fast
+    double VisionAmbiguityGain = 10; // Noise grows with pose ambiguity (0-1); this is how fast
+    double MaxAmbiguity = 0.2; // Anything more ambiguous than this is thrown out (PhotonVision recommends 0.2)
+};
+
+
+/**
+ @version 1.0
+
+ * Extended Kalman filter over { x, y, heading }. Heading is counterclockwise radians.
+
+ * Measurements are applied as sequential scalar updates, which is exact because every noise source is independent.
+ * That means no matrix inverses, and everything is a fixed 3x3 array.
+
+ * Usage:
+ * estimator.Predict(robotRelativeVelocity, dt); // every tick
+ * estimator.CorrectHeading(gyroHeading); // whenever the gyro has something
+ * estimator.CorrectPosition(innovation, estimator.VisionStdDev(distance, ambiguity)); // whenever a tag shows up
+ */
+class PoseEstimator {
+    double state[3] = { 0, 0, 0 };
+
+    /**
+     * Covariance. Starts huge: we have no idea where we are until something tells us.
+     */
+    double P[3][3] = {
+        { 1e6, 0, 0 },
+        { 0, 1e6, 0 },
+        { 0, 0, 1e6 }
+    };
+
+    /**
+     * Wrap an angle into (-PI, PI], so heading innovations take the short way around.
+     */
+    static double wrap(double angle){
+        return std::remainder(angle, 2 * PI);
+    }
+
+    /**
+     * Kalman update on a single state variable.
+     @param index Which variable is measured (0 = x, 1 = y, 2 = heading)
+     @param innovation Measurement minus prediction
+     @param variance Measurement variance
+     @param applied Gets the change made to each variable added to it
+     */
+    void update(int index, double innovation, double variance, double applied[3]){
+        double S = P[index][index] + variance;
+        double K[3];
+        double row[3];
+        for (int i = 0; i < 3; i ++){
+            K[i] = P[i][index] / S;
+            row[i] = P[index][i];
+        }
+        for (int i = 0; i < 3; i ++){
+            double change = K[i] * innovation;
+            state[i] += change;
+            applied[i] += change;
+            for (int j = 0; j < 3; j ++){
+                P[i][j] -= K[i] * row[j];
+            }
+        }
+        state[2] = wrap(state[2]);
+    }
+
+public:
+    /**
+     * Noise constants
+     */
+    PoseEstimatorConstants constants;
+
+    /**
+     * Move the estimate forward in time.
+     @param velocity Robot-relative velocity (m/s) from the wheels
+     @param dt Seconds since the last prediction
+     */
+    void Predict(vector velocity, double dt){
+        if (dt <= 0){
+            return;
+        }
+        double c = cos(state[2]);
+        double s = sin(state[2]);
+        double vx = velocity.x * c - velocity.y * s; // Rotate into the field frame
+        double vy = velocity.x * s + velocity.y * c;
+        state[0] += vx * dt;
+        state[1] += vy * dt;
+
+        // F = I + [ 0 0 -vy*dt ; 0 0 vx*dt ; 0 0 0 ]. Multiply it out by hand; it's mostly zeroes.
+        double a = -vy * dt;
+        double b = vx * dt;
+        double FP[3][3];
+        for (int j = 0; j < 3; j ++){
+            FP[0][j] = P[0][j] + a * P[2][j];
+            FP[1][j] = P[1][j] + b * P[2][j];
+            FP[2][j] = P[2][j];
+        }
+        for (int i = 0; i < 3; i ++){
+            P[i][0] = FP[i][0] + FP[i][2] * a;
+            P[i][1] = FP[i][1] + FP[i][2] * b;
+            P[i][2] = FP[i][2];
+        }
+        double wheel = constants.WheelStdDev * dt;
+        double drift = constants.HeadingDriftStdDev * dt;
+        P[0][0] += wheel * wheel;
+        P[1][1] += wheel * wheel;
+        P[2][2] += drift * drift;
+    }
+
+    /**
+     * Fuse a heading measurement (the gyro).
+     @param heading Measured heading, counterclockwise radians
+     */
+    void CorrectHeading(double heading){
+        double applied[3] = { 0, 0, 0 };
+        update(2, wrap(heading - state[2]), constants.GyroStdDev * constants.GyroStdDev, applied);
+    }
+
+    /**
+     * Fuse a position measurement.
+
+     * Takes the innovation rather than the measurement, so the caller can work it out against an older estimate (see PoseHistory).
+     * Returns how far the position estimate moved.
+     @param innovation Measured position minus estimated position
+     @param stdDev Measurement standard deviation, usually from VisionStdDev
+     */
+    vector CorrectPosition(vector innovation, double stdDev){
+        double variance = stdDev * stdDev;
+        double applied[3] = { 0, 0, 0 };
+        update(0, innovation.x, variance, applied);
+        update(1, innovation.y - applied[1], variance, applied); // x's update already moved y a little
+        return { applied[0], applied[1] };
+    }
+
+    /**
+     * Standard deviation of a vision measurement, given how far away the tag is and how ambiguous the solve was.
+     * Returns -1 if it's too ambiguous to use at all.
+     @param distance Distance to the tag, in meters
+     @param ambiguity PhotonVision pose ambiguity, 0-1
+     */
+    double VisionStdDev(double distance, double ambiguity){
+        return VisionStdDev(constants, distance, ambiguity);
+    }
+
+    /**
+     * Same thing, off some other copy of the constants. For threads that mustn't read constants while someone's tuning them (see Odometry's vision thread).
+     */
+    static double VisionStdDev(const PoseEstimatorConstants& c, double distance, double ambiguity){
+        if (ambiguity > c.MaxAmbiguity){
+            return -1;
+        }
+        return c.VisionStdDev * (1 + c.VisionDistanceGain * distance * distance) * (1 + c.VisionAmbiguityGain * ambiguity);
+    }
+
+    /**
+     * Overwrite the heading, and trust it. For when the gyro gets re-zeroed.
+     @param heading The new heading, counterclockwise radians
+     */
+    void ResetHeading(double heading){
+        state[2] = wrap(heading);
+        for (int i = 0; i < 3; i ++){
+            P[i][2] = 0;
+            P[2][i] = 0;
+        }
+        P[2][2] = constants.GyroStdDev * constants.GyroStdDev;
+    }
+
+    vector Position(){
+        return { state[0], state[1] };
+    }
+
+    double Heading(){
+        return state[2];
+    }
+
+    /**
+     * Get an element of the covariance matrix. 0 = x, 1 = y, 2 = heading.
+     */
+    double Covariance(int row, int col){
+        return P[row][col];
+    }
+
+    /**
+     * One number for "how sure are we about the position": the RMS position standard deviation, in meters.
+     */
+    double PositionStdDev(){
+        return sqrt((P[0][0] + P[1][1]) / 2);
+    }
+};
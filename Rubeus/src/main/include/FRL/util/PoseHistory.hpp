@@ -0,0 +1,161 @@
+/* Fixed-size ring buffer of timestamped poses, for latency compensation.
+    Camera frames show up tens of milliseconds after they were taken, so a measurement has to be applied to the pose we had *then*, not the one we have now.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <FRL/util/vector.hpp>
+
+
+/**
+ @version 1.0
+
+ * Ring buffer of (timestamp, pose) samples. Nothing is ever allocated; the oldest sample is overwritten when it fills.
+
+ * Timestamps are whatever clock you push them with (we use FPGA seconds), so it's entirely deterministic - nothing in here reads a clock.
+
+ * Usage:
+ * history.Push(now, pose); // every tick, with the odometry pose
+ * history.Correct(captureTime, visionPose); // when a (late) measurement comes in
+ * history.Latest(); // the fused pose, with all the motion since captureTime replayed on top
+ */
+template <size_t Length>
+class PoseHistory {
+    static_assert(Length >= 2, "Can't interpolate with less than two samples");
+
+    struct Entry {
+        double time;
+        vector pose;
+    };
+
+    Entry samples[Length];
+
+    /**
+     * Index of the next slot to write
+     */
+    size_t head = 0;
+
+    /**
+     * Number of valid samples
+     */
+    size_t count = 0;
+
+    /**
+     * Get the i-th newest sample (0 = newest). Doesn't check bounds; that's the caller's job.
+     */
+    Entry& at(size_t i){
+        return samples[(head + Length - 1 - i) % Length];
+    }
+
+public:
+    /**
+     * Record a pose. Samples must be pushed in time order; anything older than the newest sample is dropped.
+     @param time Timestamp of the pose, in seconds
+     @param pose The pose
+     */
+    void Push(double time, vector pose){
+        if (count > 0 && time < at(0).time){
+            return;
+        }
+        samples[head] = { time, pose };
+        head = (head + 1) % Length;
+        if (count < Length){
+            count ++;
+        }
+    }
+
+    /**
+     * Get the pose at a point in time, linearly interpolated between the two samples around it.
+
+     * Returns false (and leaves out alone) if the time is older than anything in the history or there is no history at all.
+     * Times newer than the newest sample give the newest sample.
+     @param time The timestamp to look up
+     @param out Where to put the pose
+     */
+    bool Sample(double time, vector& out){
+        if (count == 0 || time < at(count - 1).time){
+            return false;
+        }
+        if (time >= at(0).time){
+            out = at(0).pose;
+            return true;
+        }
+        for (size_t i = 1; i < count; i ++){
+            Entry& older = at(i);
+            if (older.time <= time){
+                Entry& newer = at(i - 1);
+                double span = newer.time - older.time;
+                double t = span > 0 ? (time - older.time) / span : 1;
+                out = older.pose + vector { (newer.pose.x - older.pose.x) * t, (newer.pose.y - older.pose.y) * t };
+                return true;
+            }
+        }
+        return false; // Unreachable, but the compiler doesn't know that
+    }
+
+    /**
+     * Apply a measurement taken at some time in the past.
+
+     * Works out how far off the history was at that time, and shifts every sample from then on by the same amount.
+     * Shifting keeps the motion between the samples intact, which is exactly the same as replaying it on top of the measurement.
+
+     * Returns false if the measurement is too old to line up with the history; it's dropped in that case.
+     @param time Capture timestamp of the measurement
+     @param measured The measured pose
+     */
+    bool Correct(double time, vector measured){
+        vector then;
+        if (!Sample(time, then)){
+            return false;
+        }
+        Shift(time, measured - then);
+        return true;
+    }
+
+    /**
+     * Move every sample from a point in time onwards. For when something else (like a Kalman filter) decided how big the correction is.
+     @param since Timestamp to start shifting at
+     @param by How far to move them
+     */
+    void Shift(double since, vector by){
+        for (size_t i = 0; i < count && at(i).time >= since; i ++){
+            at(i).pose += by;
+        }
+    }
+
+    /**
+     * The newest pose. Zero if nothing has been pushed yet.
+     */
+    vector Latest(){
+        if (count == 0){
+            return {};
+        }
+        return at(0).pose;
+    }
+
+    /**
+     * Timestamp of the newest pose. -1 if nothing has been pushed yet.
+     */
+    double LatestTime(){
+        if (count == 0){
+            return -1;
+        }
+        return at(0).time;
+    }
+
+    /**
+     * Number of samples currently stored
+     */
+    size_t Size(){
+        return count;
+    }
+
+    /**
+     * Forget everything
+     */
+    void Clear(){
+        head = 0;
+        count = 0;
+    }
+};
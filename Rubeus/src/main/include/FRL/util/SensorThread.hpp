@@ -0,0 +1,106 @@
+/* Background sensor acquisition.
+    Sensor reads go through vendor drivers that can take a while; this does all of them on its own thread,
+    so the control loop gets the lot as one snapshot without waiting on anything.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <FRL/util/Clock.hpp>
+#include <FRL/util/Seqlock.hpp>
+
+
+/**
+ @version 1.0
+
+ * Calls Poll on a fixed schedule and publishes the frame it fills in through a Seqlock.
+
+ * Frame is whatever struct you like, as long as it's trivially copyable and has a double time member; that's set to Clock::Now() right before each poll.
+ * Poll runs on the sensor thread, so it must only read hardware - don't touch anything the control loop writes.
+
+ * Usage:
+ * SensorThread <SensorFrame, readSensors> sensors { std::chrono::milliseconds(5) };
+ * sensors.Start(); // at boot
+ * SensorFrame frame = sensors.Read(); // every tick
+ */
+template <typename Frame, void (*Poll)(Frame&)>
+class SensorThread {
+    Seqlock<Frame> frame;
+    std::chrono::microseconds period;
+
+    std::thread thread;
+    std::atomic<bool> running = false;
+
+    void poll(){
+        Frame f {};
+        f.time = Clock::Now();
+        Poll(f);
+        frame.Write(f);
+    }
+
+    /**
+     * Sensor thread mainloop. Runs on a fixed schedule rather than sleeping a fixed time, so slow reads don't make it drift.
+     */
+    void loop(){
+        auto next = std::chrono::steady_clock::now();
+        while (running){
+            poll();
+            next += period;
+            auto now = std::chrono::steady_clock::now();
+            if (next < now){ // Fell behind; don't try to catch up, just carry on from here
+                next = now;
+            }
+            std::this_thread::sleep_until(next);
+        }
+    }
+
+public:
+    /**
+     @param pollPeriod How often to read everything
+     */
+    SensorThread(std::chrono::microseconds pollPeriod) : period { pollPeriod } {
+
+    }
+
+    ~SensorThread(){
+        Stop();
+    }
+
+    /**
+     * Start polling. Takes one frame right here first, so Read always has something real to give back.
+     */
+    void Start(){
+        if (running){
+            return;
+        }
+        poll();
+        running = true;
+        thread = std::thread { &SensorThread::loop, this };
+    }
+
+    /**
+     * Take a frame right now, on this thread. For simulations, which step time themselves and can't have a thread polling in real time; don't mix it with Start.
+     */
+    void PollNow(){
+        poll();
+    }
+
+    /**
+     * Stop polling and wait for the thread to exit
+     */
+    void Stop(){
+        running = false;
+        if (thread.joinable()){
+            thread.join();
+        }
+    }
+
+    /**
+     * The newest frame. Never waits on hardware; at worst it copies the frame twice.
+     */
+    Frame Read() const {
+        return frame.Read();
+    }
+};
@@ -0,0 +1,64 @@
+/* Sequence lock: one writer, any number of readers, and nobody ever holds a lock.
+    For handing a whole struct between threads when the readers have to see all of it from the same moment.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+
+/**
+ @version 1.0
+
+ * The writer bumps a counter to odd, copies the value in, and bumps it back to even.
+ * A reader copies the value out and checks the counter didn't move (and wasn't odd) while it did; if it did, it copies again.
+ * So a read is one copy of T, or two if it raced a write. The writer never waits at all.
+
+ * Unlike LatestValue, reading doesn't use the value up; every reader gets the newest one, every time.
+ * ONLY ONE WRITER THREAD! T has to be trivially copyable, since it gets memcpy'd.
+ */
+template <typename T>
+class Seqlock {
+    static_assert(std::is_trivially_copyable_v<T>, "Seqlock copies with memcpy, so T has to be trivially copyable");
+
+    std::atomic<uint32_t> sequence { 0 };
+    T value {};
+
+public:
+    /**
+     * Publish a new value. Writer thread only.
+     */
+    void Write(const T& v){
+        uint32_t s = sequence.load(std::memory_order_relaxed);
+        sequence.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(&value, &v, sizeof(T));
+        sequence.store(s + 2, std::memory_order_release);
+    }
+
+    /**
+     * Get a consistent copy of the newest value
+     */
+    T Read() const {
+        T ret;
+        uint32_t before;
+        uint32_t after;
+        do {
+            before = sequence.load(std::memory_order_acquire);
+            std::memcpy(&ret, &value, sizeof(T));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = sequence.load(std::memory_order_relaxed);
+        } while ((before & 1) || before != after);
+        return ret;
+    }
+
+    /**
+     * How many values have been written
+     */
+    uint32_t Count() const {
+        return sequence.load(std::memory_order_acquire) / 2;
+    }
+};
@@ -0,0 +1,135 @@
+/*
+    Compile-time AprilTag field map.
+    The tag list itself is generated from a layout JSON by fieldmap.py (see fieldmaps/); everything else here is worked out by the compiler.
+*/
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <FRL/util/vector.hpp>
+
+
+struct ApriltagPosition {
+    uint8_t id; // ID of this apriltag
+    double dX; // x offset in meters of this apriltag
+    double dY; // y offset in meters of this apriltag
+    float angle = 0; // Angle of the apriltag
+    double sinAngle = 0; // sin(angle) and cos(angle), precomputed so nobody does trig on them at runtime
+    double cosAngle = 1;
+};
+
+
+/**
+ @version 1.0
+
+ * Everything Odometry wants to know about the field, built once by the compiler:
+ * the tags, an id -> index table, and a grid that says which tag is nearest to any spot on the field.
+
+ * Don't construct these yourself; use MakeFieldMap.
+ */
+template <size_t Count, size_t GridX = 64, size_t GridY = 32>
+struct FieldMap {
+    static_assert(Count > 0, "A field map needs at least one tag");
+    static_assert(Count < 128, "Too many tags for an int8_t index");
+
+    static constexpr size_t TagCount = Count;
+
+    std::array<ApriltagPosition, Count> tags;
+
+    /**
+     * Tag id -> index into tags, or -1 if we don't know where that tag is
+     */
+    std::array<int8_t, 256> index;
+
+    /**
+     * True if two tags have the same id. The generated header static_asserts on this.
+     */
+    bool duplicateIDs = false;
+
+    /**
+     * Nearest-tag grid. Each cell has the index of the tag closest to its center; it covers the tags plus a margin on every side.
+     */
+    std::array<uint8_t, GridX * GridY> nearest;
+    double minX;
+    double minY;
+    double cellX;
+    double cellY;
+
+    /**
+     * Look up a tag by id. Returns 0 (null) if it's not on the field.
+     @param id The fiducial id
+     */
+    constexpr const ApriltagPosition* Find(int id) const {
+        if (id < 0 || id > 255 || index[id] == -1){
+            return 0;
+        }
+        return &tags[index[id]];
+    }
+
+    /**
+     * The tag closest to a field position. Constant time: it's one grid lookup. Anything off the grid is treated as the closest edge cell.
+     @param pos Field position in meters
+     */
+    constexpr const ApriltagPosition& Nearest(vector pos) const {
+        long cx = (long)((pos.x - minX) / cellX);
+        long cy = (long)((pos.y - minY) / cellY);
+        cx = cx < 0 ? 0 : (cx >= (long)GridX ? GridX - 1 : cx);
+        cy = cy < 0 ? 0 : (cy >= (long)GridY ? GridY - 1 : cy);
+        return tags[nearest[cy * GridX + cx]];
+    }
+};
+
+
+/**
+ * Build a FieldMap from a list of tags. Meant to be used as a constexpr initializer (which is what fieldmap.py generates).
+ @param tags The tags
+ @param margin How far past the outermost tags the nearest-tag grid reaches, in meters
+ */
+template <size_t GridX = 64, size_t GridY = 32, size_t Count>
+constexpr FieldMap<Count, GridX, GridY> MakeFieldMap(const ApriltagPosition (&tags)[Count], double margin = 2){
+    FieldMap<Count, GridX, GridY> ret {};
+    ret.index.fill(-1);
+    for (size_t i = 0; i < Count; i ++){
+        ret.tags[i] = tags[i];
+        if (ret.index[tags[i].id] != -1){
+            ret.duplicateIDs = true;
+        }
+        ret.index[tags[i].id] = i;
+    }
+
+    double maxX = tags[0].dX;
+    double maxY = tags[0].dY;
+    ret.minX = tags[0].dX;
+    ret.minY = tags[0].dY;
+    for (size_t i = 1; i < Count; i ++){
+        ret.minX = tags[i].dX < ret.minX ? tags[i].dX : ret.minX;
+        ret.minY = tags[i].dY < ret.minY ? tags[i].dY : ret.minY;
+        maxX = tags[i].dX > maxX ? tags[i].dX : maxX;
+        maxY = tags[i].dY > maxY ? tags[i].dY : maxY;
+    }
+    ret.minX -= margin;
+    ret.minY -= margin;
+    ret.cellX = (maxX + margin - ret.minX) / GridX;
+    ret.cellY = (maxY + margin - ret.minY) / GridY;
+
+    for (size_t cy = 0; cy < GridY; cy ++){
+        for (size_t cx = 0; cx < GridX; cx ++){
+            double x = ret.minX + (cx + 0.5) * ret.cellX;
+            double y = ret.minY + (cy + 0.5) * ret.cellY;
+            size_t best = 0;
+            double bestD = -1;
+            for (size_t i = 0; i < Count; i ++){
+                double dx = tags[i].dX - x;
+                double dy = tags[i].dY - y;
+                double d = dx * dx + dy * dy;
+                if (bestD < 0 || d < bestD){
+                    bestD = d;
+                    best = i;
+                }
+            }
+            ret.nearest[cy * GridX + cx] = best;
+        }
+    }
+    return ret;
+}
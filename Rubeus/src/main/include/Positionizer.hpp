@@ -1,17 +1,19 @@
 /*
-    Use apriltags and navx displacement readings to know where you are
+    Use apriltags, the navx and the swerve wheels to know where you are
     Odometryyyyyyyyyyyyyyyyyyyyyy
 */
+#include <array>
+#include <thread>
+#include <chrono>
+#include <atomic>
 #include <AHRS.h>
 #include <photonlib/PhotonCamera.h>
-
-
-struct ApriltagPosition {
-    uint8_t id; // ID of this apriltag
-    double dX; // x offset in meters of this apriltag
-    double dY; // y offset in meters of this apriltag
-    float angle = 0; // Angle of the apriltag
-};
+#include <FRL/util/PoseHistory.hpp>
+#include <FRL/util/PoseEstimator.hpp>
+#include <FRL/util/LatestValue.hpp>
+#include <FRL/util/Clock.hpp>
+#include <FRL/swerve/SwerveModule.hpp>
+#include "FieldMap.hpp"
 
 
 struct Position2D {
@@ -20,73 +22,246 @@ struct Position2D {
 };
 
 
+/**
+ * One camera frame's worth of pose solve, handed from the vision thread to the main loop.
+ */
+struct VisionEstimate {
+    bool hasTargets = false; // Whether the frame had any tags in it at all
+    bool valid = false; // Whether any of them were usable; pose and stdDev are garbage if not
+    vector pose;
+    double stdDev;
+    int used = 0; // How many tags went into it
+};
+
+
 enum OdometryQuality {
     AOK, // an AprilTag is being actively tracked
-    STALE, // Bearings were established by AprilTag, but there is no longer an apriltag in view (using NavX odometry)
-    BAD // No apriltags present and bearings have not been established - values are purely NavX.
+    STALE, // Bearings were established by AprilTag, but there is no longer an apriltag in view (using wheel odometry)
+    BAD // No apriltags present and bearings have not been established - values are purely wheel odometry.
 };
 
 
-template <uint8_t TagCount, const ApriltagPosition Tags[TagCount], AHRS* Navx> // I'm just doing this for the fun of it, really :D
+template <const auto& Field, AHRS* Navx, auto* Swerve, size_t HistoryLength = 50> // I'm just doing this for the fun of it, really :D
 class Odometry {
-    Position2D lastGoodResult { 0, 0 };
     Position2D lastResult { 0, 0 };
     bool isValid = false;
     bool isStale = true;
-    photonlib::PhotonCamera camera;
+    int tagsUsed = 0; // In the last frame
+    photonlib::PhotonCamera camera; // Only ever touched by the vision thread once it's running
 
-    double orientation;
     double lastNavxHeading;
 
+    /**
+     * Newest solve from the vision thread, timestamped with when the frame was captured.
+     */
+    LatestValue<VisionEstimate> vision;
+    std::thread visionThread;
+    std::atomic<bool> visionRunning = false;
+    bool externalVision = false; // Estimates come from PublishVision, so the camera thread never starts
+    PoseEstimatorConstants visionConstants; // The vision thread's own copy of estimator.constants, taken when it starts
+
+    /**
+     * Vision thread mainloop. Pulls camera results as they come in (NetworkTables deserialization is not cheap), solves them, and publishes the estimate.
+     * No locks and no allocation of our own, and it exits by itself when visionRunning goes false - none of the pthread_cancel trouble the old RobotMode::Thread had.
+     */
+    void visionLoop(){
+        double lastCaptureTime = -1; // So the same frame doesn't get solved twice
+        while (visionRunning){
+            auto dat = camera.GetLatestResult();
+            double captureTime = (double)dat.GetTimestamp();
+            if (captureTime != lastCaptureTime){
+                lastCaptureTime = captureTime;
+                VisionEstimate est;
+                est.hasTargets = dat.HasTargets();
+                est.valid = est.hasTargets && solve(dat, est.pose, est.stdDev, est.used);
+                vision.Publish(captureTime, est);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5)); // Faster than any camera we've got
+        }
+    }
+
+    /**
+     * Solve for the field position from every visible tag we know about.
+
+     * Each tag gives its own position estimate; they're combined by weighted least squares, weighting each by 1/variance.
+     * For a position that's just the weighted mean, and the combined variance is 1/(sum of weights) - so two good tags really are better than one.
+
+     * Returns false if there wasn't a single usable tag.
+     * Runs on the vision thread! It reads visionConstants, never estimator, and leaves the dashboard to the main loop.
+     @param dat The camera result
+     @param pose Gets the combined field position
+     @param stdDev Gets the combined standard deviation
+     @param used Gets how many tags it used
+     */
+    bool solve(const photonlib::PhotonPipelineResult& dat, vector& pose, double& stdDev, int& used){
+        vector weighted;
+        double totalWeight = 0;
+        used = 0;
+        for (const photonlib::PhotonTrackedTarget& targ : dat.GetTargets()){
+            const ApriltagPosition* tag = Field.Find(targ.GetFiducialId()); // Compile-time id table, so this is one array read
+            if (!tag){
+                continue;
+            }
+            auto pos = targ.GetBestCameraToTarget();
+            vector r { (double)pos.X(), (double)pos.Y() }; // Robot position relative to apriltag
+            double sd = PoseEstimator::VisionStdDev(visionConstants, r.magnitude(), targ.GetPoseAmbiguity());
+            if (sd <= 0){ // Too ambiguous to trust
+                continue;
+            }
+            vector d { // Robot relative to field: rotate by the tag angle (precomputed sin/cos) and add the tag position
+                tag -> dX + r.x * tag -> cosAngle - r.y * tag -> sinAngle,
+                tag -> dY + r.x * tag -> sinAngle + r.y * tag -> cosAngle
+            };
+            double weight = 1 / (sd * sd);
+            weighted += { d.x * weight, d.y * weight };
+            totalWeight += weight;
+            used ++;
+        }
+        if (used == 0){
+            return false;
+        }
+        pose = { weighted.x / totalWeight, weighted.y / totalWeight };
+        stdDev = sqrt(1 / totalWeight);
+        return true;
+    }
+
+    /**
+     * Fused poses for the last HistoryLength ticks (about a second at 50hz). Camera results get applied at their capture time, not whenever we happen to read them.
+     */
+    PoseHistory<HistoryLength> history;
+    double lastUpdateTime = -1;
+
+    double wheelScale; // Swerve speed motor velocity -> meters per second
+    double headingOffset = 0; // Navx heading that counts as 0, in degrees. Same thing as navxOffset in Robot.cpp.
+
+    /**
+     * Navx heading as counterclockwise radians (the navx itself is clockwise degrees)
+     */
+    double navxHeading(){
+        return -((sensed ? sensedHeading : Navx -> GetFusedHeading()) - headingOffset) * PI/180;
+    }
+
+    bool sensed = false; // Whether Use() has given us a snapshot yet
+    double sensedHeading; // Navx fused heading from the snapshot, degrees
+    double sensedTime; // When the snapshot was taken
+
 public:
-    Odometry (const char* camName) : camera { camName } {};
+    /**
+     * The Kalman filter doing the actual fusing. Tune it through estimator.constants.
+     */
+    PoseEstimator estimator;
+
+    /**
+     * Constructor
+     @param camName PhotonVision camera name
+     @param wheelSpeedToMPS Multiply the swerve speed motor velocity by this to get meters per second
+     */
+    Odometry (const char* camName, double wheelSpeedToMPS) : camera { camName } {
+        wheelScale = wheelSpeedToMPS;
+    };
+
+    ~Odometry (){
+        Stop();
+    }
+
+    /**
+     * Start the vision thread. Update() does this itself the first time it runs (we're a global, so the constructor is way too early for NetworkTables).
+     * Does nothing if estimates are coming from PublishVision instead. The thread works off a copy of estimator.constants from now; Stop and Start again to pick up changes.
+     */
+    void Start(){
+        if (visionRunning || externalVision){
+            return;
+        }
+        visionConstants = estimator.constants;
+        visionRunning = true;
+        visionThread = std::thread { &Odometry::visionLoop, this };
+    }
+
+    /**
+     * Stop the vision thread and wait for it to exit.
+     */
+    void Stop(){
+        visionRunning = false;
+        if (visionThread.joinable()){
+            visionThread.join();
+        }
+    }
+
+    /**
+     * Re-zero the heading. Call this whenever the navx offset changes, or the wheel odometry will be rotated wrong.
+     @param navxOffset The navx heading (degrees) that now counts as 0
+     */
+    void SetHeadingOffset(double navxOffset){
+        headingOffset = navxOffset;
+        estimator.ResetHeading(navxHeading());
+    }
+
+    /**
+     * Hand Odometry this tick's sensor snapshot, so it doesn't read the navx itself. (The swerve modules get theirs separately.)
+     @param navxFusedHeading Navx fused heading, degrees
+     @param time When the snapshot was taken; the wheel speeds are from then, too
+     */
+    void Use(double navxFusedHeading, double time){
+        sensedHeading = navxFusedHeading;
+        sensedTime = time;
+        sensed = true;
+    }
+
+    /**
+     * Hand Odometry a vision estimate from somewhere other than its camera (a simulation, a benchmark). Once this has been called the vision thread never starts.
+     * Refused (returns false) if the vision thread is already running: it's the only writer vision gets.
+     @param captureTime When the frame was taken
+     @param est The solve
+     */
+    bool PublishVision(double captureTime, const VisionEstimate& est){
+        if (visionRunning){
+            return false;
+        }
+        externalVision = true;
+        vision.Publish(captureTime, est);
+        return true;
+    }
 
     const Position2D Update() {
         Position2D ret;
-        auto dat = camera.GetLatestResult();
-        if (dat.HasTargets()){
-            Navx -> ResetDisplacement(); // If there's a valid target, zero the navx displacement
-            photonlib::PhotonTrackedTarget targ;
-            double bestAmbi = 2; // ambiguity is 0-1, so this is an impossibly high value
-            auto targets = dat.GetTargets();
-            for (photonlib::PhotonTrackedTarget t : targets){
-                if (t.GetPoseAmbiguity() < bestAmbi) {
-                    bestAmbi = t.GetPoseAmbiguity();
-                    targ = t;
+        double now = sensed ? sensedTime : Clock::Now();
+        vector wheels = Swerve -> GetAverageLinkVelocity();
+        wheels = vector { wheels.x * wheelScale, wheels.y * wheelScale }.rotate(-PI/2); // Direction encoder frame is a quarter turn off the robot frame
+        estimator.Predict(wheels, lastUpdateTime == -1 ? 0 : now - lastUpdateTime);
+        estimator.CorrectHeading(navxHeading());
+        lastUpdateTime = now;
+        history.Push(now, estimator.Position()); // This is the motion that gets replayed on top of late camera frames
+        if (!externalVision){
+            Start();
+        }
+        VisionEstimate est;
+        double captureTime;
+        if (vision.Read(est, captureTime)){ // Only does anything if the vision thread has a frame we haven't used yet
+            tagsUsed = est.used;
+            if (est.hasTargets){
+                isStale = false; // Upon seeing an AprilTag, it is no longer stale
+                isValid = est.valid; // If it can see an AprilTag, and knows where that AprilTag is on the field, then it's reporting valid values.
+                vector then;
+                if (est.valid && history.Sample(captureTime, then)){ // Compare it to where we thought we were when the frame was taken
+                    vector applied = estimator.CorrectPosition(est.pose - then, est.stdDev);
+                    history.Shift(captureTime, applied);
                 }
             }
-            frc::SmartDashboard::PutNumber("Target ambiguity", targ.GetPoseAmbiguity());
-            auto pos = targ.GetBestCameraToTarget();
-            ret.x = (double)pos.X();
-            ret.y = (double)pos.Y();
-            isValid = false; // Reset validity
-            isStale = false; // Upon seeing an AprilTag, it is no longer stale
-            frc::SmartDashboard::PutNumber("seek id", targ.GetFiducialId());
-            for (uint8_t tag = 0; tag < TagCount; tag ++){
-                if (Tags[tag].id == targ.GetFiducialId()){
-                    vector v { Tags[tag].dX, Tags[tag].dY }; // Apriltag position relative to field
-                    vector r { ret.x, ret.y }; // Robot position relative to apriltag
-                    vector d = v + r.rotate(Tags[tag].angle); // Robot relative to field
-                    ret.x = d.x;
-                    ret.y = d.y;
-                    isValid = true; // If it can see an AprilTag, and knows where that AprilTag is on the field, then it's reporting valid values.
-                    orientation = targ.GetYaw() + Tags[tag].angle * 180/PI;
-                }
+            else{
+                isStale = true; // If it doesn't have an AprilTag, it's relying on wheel odometry, and is thus stale
             }
-            lastGoodResult.x = ret.x;
-            lastGoodResult.y = ret.y;
-        }
-        else{
-            ret.x = lastGoodResult.x;
-            ret.y = lastGoodResult.y;
-            //ret.x += Navx -> GetDisplacementX();
-            //ret.y += Navx -> GetDisplacementY();
-            isStale = true; // If it doesn't have an AprilTag, it's relying on navX odometry, and is thus stale
         }
+        vector fused = estimator.Position();
+        ret.x = fused.x;
+        ret.y = fused.y;
         lastResult = ret;
         return ret;
     }
 
+    int TagsUsed() { // How many tags went into the last camera frame's solve
+        return tagsUsed;
+    }
+
     bool Valid() { // If the values it reports are not garbage
         return isValid;
     }
@@ -95,6 +270,20 @@ public:
         return isValid && !isStale;
     }
 
+    /**
+     * Position uncertainty (RMS standard deviation) in meters. Way more useful than Quality() if you want to know how much to trust it.
+     */
+    double StdDev(){
+        return estimator.PositionStdDev();
+    }
+
+    /**
+     * Get an element of the pose covariance matrix. 0 = x, 1 = y, 2 = heading.
+     */
+    double Covariance(int row, int col){
+        return estimator.Covariance(row, col);
+    }
+
     OdometryQuality Quality(){
         if (isStale){
             if (isValid){
@@ -108,18 +297,7 @@ public:
     }
 
     ApriltagPosition Nearest() {
-        int bestI = 0;
-        double bestD = 9999999999; // probably not gonna hit this many meters on the field
-        for (int i = 0; i < TagCount; i ++){
-            double dx = Tags[i].dX - lastResult.x;
-            double dy = Tags[i].dY - lastResult.y;
-            double hyp2 = dx * dx + dy * dy;
-            if (hyp2 < bestD){
-                bestD = hyp2;
-                bestI = i;
-            }
-        }
-        return Tags[bestI];
+        return Field.Nearest({ lastResult.x, lastResult.y }); // Precomputed grid; no distance scan
     }
 
     double NearestAngle(){
@@ -1,13 +1,21 @@
 #include <FRL/motor/BaseMotor.hpp>
+#include <algorithm>
 #include <frc/AnalogInput.h>
 #include <FRL/motor/PIDController.hpp>
 #include <frc/DigitalInput.h>
 #include <frc/DoubleSolenoid.h>
 #include <frc/Compressor.h>
 #include <FRL/motor/CurrentWatcher.hpp>
-
-const double shoulderBarLengthCM = 91.44; // Length of the forearm in centimeters
-const double elbowBarLengthCM = 91.44; // What can I call it? Anti-forearm? Arm? Elbow-y bit? Yeah. Elbow-y bit. This is the elbow-y bit length in centimeters.
+#include <FRL/motor/HealthMonitor.hpp>
+#include <FRL/util/OversampledEncoder.hpp>
+#include <FRL/util/InterruptInput.hpp>
+#include "ArmKinematics.hpp"
+#include "ArmTrajectory.hpp"
+#include "ArmMap.hpp"
+#include "ArmDynamics.hpp"
+#include <FRL/util/Clock.hpp>
+#include <atomic>
+#include <cassert>
 
 const double shoulderDefaultAngle = 80; // I calculated. At displacement x 5, displacement y is 30. So it's atan(30/5). Which is about 80.5 degrees.
 const double elbowDefaultAngle = 280; // Reflect the angle of the shoulder about the x axis
@@ -25,17 +33,60 @@ struct ArmPosition {
     float y;
 };
 
-const vector lowPole { 130, 76.36 };
-const vector highPole { 130, 106.84 };
-const vector home { 35, 0 };
+constexpr vector lowPole { 130, 76.36 };
+constexpr vector highPole { 130, 106.84 };
+constexpr vector home { 35, 0 };
+constexpr vector pickup { 100, 0 };
+
+// Shoulder angle that holds the head up clear of the bumper. Presets go through it if the straight path is blocked (see ArmPlanner).
+constexpr double bumperShoulderAngle = 80; // Degrees
+
+
+/**
+ * A fixed arm position, solved at compile time. Going to one costs no IK at runtime.
+ */
+struct ArmPreset {
+    vector head;
+    JointAngles joints;
+    JointAngles clearance; // Via point for getting round the bumper: shoulder up, elbow already where it's going
+};
+
+constexpr ArmPreset MakeArmPreset(vector head){
+    JointAngles joints = ArmIK(head.x, head.y);
+    return { head, joints, { bumperShoulderAngle * cexpr::pi/180, joints.elbow, joints.reachable } };
+}
+
+enum ArmPresetID {
+    PRESET_HOME,
+    PRESET_PICKUP,
+    PRESET_LOW_POLE,
+    PRESET_HIGH_POLE,
+    PRESET_COUNT
+};
+
+constexpr ArmPreset armPresets[PRESET_COUNT] {
+    MakeArmPreset(home),
+    MakeArmPreset(pickup),
+    MakeArmPreset(lowPole),
+    MakeArmPreset(highPole)
+};
+
+constexpr bool armPresetsReachable(){
+    for (const ArmPreset& preset : armPresets){
+        if (!preset.joints.reachable){
+            return false;
+        }
+    }
+    return true;
+}
+static_assert(armPresetsReachable(), "An arm preset is out of reach");
 
 struct ArmInfo {
 /*
     Arm math structure, to clean up.
-    Generates values for the encoders, and stores all the intermediate calculations.
-    Units: Degrees (needs to be radians).
+    Generates values for the encoders. The solve itself is ArmIK (ArmKinematics.hpp), in radians;
+    n and omega are kept in degrees because that's what the hardware translation layer (class Arm) converts to encoder ticks.
 
-    This is virtual math only; the hardware translation layer (class Arm) should convert to encoder ticks.
     Usage:
     armInfo.goal = ...; // goal position
     armInfo.curHeadX = ...; // current head x position
@@ -43,42 +94,27 @@ struct ArmInfo {
     armInfo.Update(); // convert goal pos to angles
     // RestrictOutputs goes here, because RestrictOutputs is a post-processing thing
 */
-    double omega; // Elbow composites - omega = true goal angle, theta = goal dist from shoulder
-    double theta;
-    double y; // Angle between the appropriate vertical line and the shoulder
-    double a; // Angle between the appropriate vertical line and the elbow
-    double n; // Real (goal) angle of the shoulder
-    double f; // Angle between goal-vector and shoulder
-    double x; // Angle of the goal-vector
-    double s;
+    JointAngles joints; // The solve, radians
+    double n; // Real (goal) angle of the shoulder, degrees
+    double omega; // Goal angle of the elbow bar, degrees, less the 10 degree elbow calibration offset (GetElbowPos adds it back)
 
 
-    vector goal; // The program sets these and uses gamma and n.
+    vector goal; // The program sets these and uses omega and n.
     double curHeadX;
     double curHeadY;
     // Current head position is needed for Restrict...() functions.
 
-    double GetTheta(){
-        double base = goal.magnitude() / 2;
-        double thetaOverTwo = asin(base / shoulderBarLengthCM) * 180/PI;
-        return smartLoop(thetaOverTwo * 2, 360);
-        // It's an isoscelese triangle. That means we can divide it up into two right triangles about the base and theta; each one has an angle of F
-        // and an angle of theta/2, and the base is the original base/2. Also, each one has a hypotenuse of shoulderBarLengthCM (or elbowBarLengthCM; they're the same),
-        // Sin is defined as opposite/hypotenuse (SOHCAHTOA!), so to get that top angle (which is, remember, theta/2), we use asin(base/shoulderBarLengthCM). The
-        // resulting angle is exactly half of theta, so we multiply by two and convert to degrees.
-    }
-
-    void Update (){ // Do the calculations to set *every* variable
-        x = smartLoop(goal.angle() * 180/PI, 360);
-        theta = GetTheta();
-        f = smartLoop((180 - theta) / 2, 360); // F is an angle in an isoscelese triangle. It is equal to d. The equation for any triangle is,
-        // f + d + theta = 180; since this is an isoscelese triangle, we know that f == d, and f * 2 + theta = 180. Solve for f,
-        // we get f = (180 - theta) / 2.
-        n = smartLoop(f + x, 360); // n = f + x. Check the chart.
-        y = smartLoop(90 - n, 360); // Yep.
-        a = smartLoop(theta - y, 360); // Check the chart.
-        omega = smartLoop(270 + a - 10, 360); // Check das chart.
-        s = smartLoop(180 - a, 360); // Note: s and gamma are related, but 360 - s != gamma.
+    void Update (){
+        Set(ArmIK(goal.x, goal.y));
+    }
+
+    /**
+     * Take joint angles that are already solved (an ArmPreset's) instead of solving for goal
+     */
+    void Set(const JointAngles& solved){
+        joints = solved;
+        n = cexpr::wrap(joints.shoulder * 180/cexpr::pi, 360);
+        omega = cexpr::wrap(joints.elbow * 180/cexpr::pi - 10, 360);
     }
 
     void RestrictOutputs(double shoulderMax, double shoulderMin, double elbowMax, double elbowMin){
@@ -100,71 +136,217 @@ struct ArmInfo {
 };
 
 
-template <int elbowID, int shoulderID, int boopID, int elbowLimitswitchID, int shoulderLimitswitchID>
+/**
+ * Everything the Arm reads off its hardware, raw. See Arm::Sense() and Arm::Use().
+ */
+struct ArmReadings {
+    double shoulderEncoder; // Filtered ticks (see OversampledEncoder)
+    double elbowEncoder;
+    double shoulderCurrent;
+    double elbowCurrent;
+    double handCurrent;
+    // The switches aren't here: they latch themselves off their interrupts, which beats any snapshot (see InterruptInput)
+};
+
+
+template <MotorType Motor, int elbowID, int shoulderID, int boopID, int elbowLimitswitchID, int shoulderLimitswitchID, typename AnalogEncoder = frc::AnalogInput, typename Switch = frc::DigitalInput> // Sensor types are swappable for simulation (FRL/sim)
 class Arm {
 public:
+    /**
+     * What the arm reads off its motors: current for the CurrentWatchers, the HealthMonitor and the dashboard. The joints run off the analog encoders.
+     */
+    static constexpr StatusNeeds JointStatus = CurrentWatcher<Motor>::Needs | HealthMonitorStatus;
+    static constexpr StatusNeeds HandStatus = HealthMonitorStatus;
+
     long elbowDefaultEncoderTicks = 0;
     long shoulderDefaultEncoderTicks = 0;
 
     bool handState = false;
-    BaseMotor* shoulder;
-    BaseMotor* elbow;
-    BaseMotor* hand;
-    PIDController<BaseMotor>* elbowController;
-    PIDController<BaseMotor>* shoulderController;
-    CurrentWatcher* shoulderWatcher;
-    CurrentWatcher* elbowWatcher;
-    std::vector<ArmPosition> stack;
+    Motor shoulder; // Held by value; Motor is the concrete type (SparkMotor), so calls on these don't go through a vtable
+    Motor elbow;
+    Motor hand;
+    PIDController<Motor> elbowController { &elbow };
+    PIDController<Motor> shoulderController { &shoulder };
+    CurrentWatcher<Motor> shoulderWatcher { &shoulder, 35, 2 };
+    CurrentWatcher<Motor> elbowWatcher { &elbow, 3, 2 };
     vector goalPos;
+    const ArmPreset* preset = nullptr; // Set when goalPos is a preset, so Update can skip the IK
     ArmInfo info;
+    ArmPlanner planner;
+    ArmMap map { planner.constants }; // Load it at startup; until then (or if it's stale) armGoToPos checks goals the slow way
+    ArmDynamicsConstants dynamics; // For feedforward: the joints' PID only fixes what this gets wrong
+    const ArmTrajectory* trajectory = nullptr; // What Update is following. Points into planner's cache; only replaced when the goal changes, so it stays put.
+    ArmJoints plannedGoal;
+    double trajectoryStart = 0;
     bool retract = false;
     bool sweeping = false;
-    frc::DigitalInput elbowLimitSwitch { elbowLimitswitchID };
-    frc::DigitalInput shoulderLimitSwitch { shoulderLimitswitchID };
-
-    Arm(BaseMotor* s, BaseMotor* e, BaseMotor* h){
-        shoulder = s;
-        elbow = e;
-        hand = h;
-        elbowController = new PIDController(e);
-        elbowController -> constants.P = 0.005;
-        //elbowController -> constants.D = 0.0045;
-        elbowController -> constants.MinOutput = -0.25;
-        elbowController -> constants.MaxOutput = 0.25;
-        shoulderController = new PIDController(s);
-        shoulderController -> constants.P = 0.0025;
-        shoulderController -> constants.I = 0;
-        //shoulderController -> constants.D = 0.0045;
-        shoulderController -> constants.MinOutput = -0.15;
-        shoulderController -> constants.MaxOutput = 0.15;
-        elbowController -> SetCircumference(4096);
-        shoulderController -> SetCircumference(4096);
-        shoulder -> ConfigIdleToBrake();
-        elbow -> ConfigIdleToBrake();
-        shoulderWatcher = new CurrentWatcher { shoulder, 35, 2 };
-        elbowWatcher = new CurrentWatcher { elbow, 3, 2 };
-    }
-
-    frc::AnalogInput elbowEncoder { elbowID };
-    frc::AnalogInput shoulderEncoder { shoulderID };
-    frc::DigitalInput boop { boopID };
+    ArmReadings readings {};
+    bool sensed = false; // Whether Use() has given us a snapshot yet
+    bool sensorThread = false; // Whether Sense() runs on a SensorThread; if so, nothing else may sample the encoders (see UseSensorThread)
+    double shoulderScale = 1; // Output multipliers, from SetOutputScale
+    double elbowScale = 1;
+    double handScale = 1;
+    double handSpeed = 0.35; // Intake; barfing is the same, backwards
+    std::atomic<bool> shoulderHit = false; // At a limit, as of the switches' last edges: set as they close, cleared as they open. Keeps the loop from driving a joint its interrupt just stopped
+    std::atomic<bool> elbowHit = false;
+    std::atomic<GrabMode> handMode = OFF; // What Update last told the hand to do. Atomic: boop's interrupt handler reads it
+    InterruptInput <Switch> elbowLimitSwitch { elbowLimitswitchID };
+    InterruptInput <Switch> shoulderLimitSwitch { shoulderLimitswitchID };
+
+    Arm(int shoulderCAN, int elbowCAN, int handCAN) : shoulder { shoulderCAN }, elbow { elbowCAN }, hand { handCAN } {
+        elbowController.constants.P = 0.005;
+        //elbowController.constants.D = 0.0045;
+        elbowController.constants.MinOutput = -0.25;
+        elbowController.constants.MaxOutput = 0.25;
+        shoulderController.constants.P = 0.0025;
+        shoulderController.constants.I = 0;
+        //shoulderController.constants.D = 0.0045;
+        shoulderController.constants.MinOutput = -0.15;
+        shoulderController.constants.MaxOutput = 0.15;
+        elbowController.SetCircumference(4096);
+        shoulderController.SetCircumference(4096);
+        shoulder.ConfigIdleToBrake();
+        elbow.ConfigIdleToBrake();
+        shoulder.SetStatusFrames(JointStatus);
+        elbow.SetStatusFrames(JointStatus);
+        hand.SetStatusFrames(HandStatus);
+        // Stop at a switch the moment it closes, from the interrupt thread, instead of up to a loop later; the latch keeps the loop from driving back into it until it opens (see holdLimits).
+        // The loop writes these motors too, so a command it was already sending can land just after the stop; the next loop sees the latch and stops it again
+        shoulderLimitSwitch.Start([this](bool level){
+            shoulderHit = level; // Normally Closed: true is at the limit
+            if (level){
+                shoulder.SetPercent(0);
+            }
+        });
+        elbowLimitSwitch.Start([this](bool level){
+            elbowHit = !level; // Normally Open
+            if (!level){
+                elbow.SetPercent(0);
+            }
+        });
+        boop.Start([this](bool level){
+            if (!level && handMode == INTAKE){ // Got one; don't suck it through
+                hand.SetPercent(0);
+                handMode = OFF;
+            }
+        });
+    }
+
+    OversampledEncoder <AnalogEncoder> elbowEncoder { elbowID };
+    OversampledEncoder <AnalogEncoder> shoulderEncoder { shoulderID };
+    InterruptInput <Switch> boop { boopID };
+
+    using Readings = ArmReadings;
+
+    /**
+     * Read all of the arm's sensors. Only touches the hardware, so it's safe to call from a sensor thread (see SensorThread).
+     */
+    Readings Sense(){
+        return {
+            shoulderEncoder.Sample(), // The only place the encoders get sampled: once per poll
+            elbowEncoder.Sample(),
+            shoulder.GetCurrent(),
+            elbow.GetCurrent(),
+            hand.GetCurrent()
+        };
+    }
+
+    /**
+     * Say Sense() is going to be called on a SensorThread. Call it before that thread starts. From then on the sensor thread is the only one that samples the encoders:
+     * Update waits for the first snapshot (see Use) instead of sampling them itself, so two threads never run the filters at once.
+     */
+    void UseSensorThread(){
+        sensorThread = true;
+    }
+
+    /**
+     * Hand the arm a snapshot from Sense(). From then on it works off snapshots and never reads the hardware in the control loop.
+     */
+    void Use(const Readings& r){
+        readings = r;
+        sensed = true;
+    }
+
+    /**
+     * How much current the arm would draw at full (unscaled) output, going by what it's drawing now. For PowerManager.
+     */
+    double Demand(){
+        double handDraw = sensed ? readings.handCurrent : hand.GetCurrent();
+        return shoulderCurrent() / std::max(shoulderScale, 0.1) + elbowCurrent() / std::max(elbowScale, 0.1) + handDraw / std::max(handScale, 0.1);
+    }
+
+    /**
+     * Scale the arm's motors' outputs down, for derating (see HealthMonitor) or power budgeting
+     @param shoulderScale Multiplier on the shoulder, 0-1
+     @param elbowScale Multiplier on the elbow, 0-1
+     @param handScale Multiplier on the hand, 0-1
+     */
+    void SetOutputScale(double shoulderScale, double elbowScale, double handScale){
+        this -> shoulderScale = shoulderScale;
+        this -> elbowScale = elbowScale;
+        this -> handScale = handScale;
+        shoulderController.outputScale = shoulderScale;
+        elbowController.outputScale = elbowScale;
+    }
+
+    // Sensor values, from the snapshot if there is one
+    double shoulderValue(){
+        return sensed || sensorThread ? readings.shoulderEncoder : shoulderEncoder.GetValue(); // The filter's the sensor thread's, if there is one
+    }
+
+    double elbowValue(){
+        return sensed || sensorThread ? readings.elbowEncoder : elbowEncoder.GetValue();
+    }
+
+    double shoulderCurrent(){
+        return sensed ? readings.shoulderCurrent : shoulder.GetCurrent();
+    }
+
+    double elbowCurrent(){
+        return sensed ? readings.elbowCurrent : elbow.GetCurrent();
+    }
+
+    // Switches, as of their last edge (the DigitalInputs' raw level, before anyone works out which way round they're wired)
+    bool shoulderSwitch(){
+        return shoulderLimitSwitch.Level();
+    }
+
+    bool elbowSwitch(){
+        return elbowLimitSwitch.Level();
+    }
+
+    bool boopValue(){
+        return boop.Level();
+    }
 
     void test(){
         //goalX += 0.002;
         //vector goal = { 60, 5 };
         //frc::SmartDashboard::PutNumber("Goal X", goal.x);
-        //shoulderController -> SetPosition(halfPos);
-        frc::SmartDashboard::PutNumber("Shoulder real", shoulderEncoder.GetValue());
+        //shoulderController.SetPosition(halfPos);
+        frc::SmartDashboard::PutNumber("Shoulder real", shoulderValue());
         frc::SmartDashboard::PutNumber("Shoulder nice", GetShoulderPos());
-        frc::SmartDashboard::PutNumber("Elbow real", elbowEncoder.GetValue());
+        frc::SmartDashboard::PutNumber("Elbow real", elbowValue());
         frc::SmartDashboard::PutNumber("Elbow nice", GetElbowPos());
         ArmPosition p = GetArmPosition();
         frc::SmartDashboard::PutNumber("Head X", p.x);
         frc::SmartDashboard::PutNumber("Head Y", p.y);
-        frc::SmartDashboard::PutNumber("Shoulder Current", shoulder -> GetCurrent());
-        frc::SmartDashboard::PutNumber("Elbow Current", elbow -> GetCurrent());
-        frc::SmartDashboard::PutBoolean("Elbow Danger", !elbowWatcher -> isEndangered);
-        frc::SmartDashboard::PutBoolean("Shoulder Danger", !shoulderWatcher -> isEndangered);
+        frc::SmartDashboard::PutNumber("Shoulder Current", shoulderCurrent());
+        frc::SmartDashboard::PutNumber("Elbow Current", elbowCurrent());
+        frc::SmartDashboard::PutBoolean("Elbow Danger", !elbowWatcher.isEndangered);
+        frc::SmartDashboard::PutBoolean("Shoulder Danger", !shoulderWatcher.isEndangered);
+        frc::SmartDashboard::PutNumber("Arm encoder delay ms", shoulderEncoder.GroupDelay() * 1000);
+        frc::SmartDashboard::PutNumber("Shoulder switch edges", shoulderLimitSwitch.Edges());
+        frc::SmartDashboard::PutNumber("Elbow switch edges", elbowLimitSwitch.Edges());
+        frc::SmartDashboard::PutNumber("Boop edges", boop.Edges());
+        // Update's and checkSwitches' numbers. They're published here, not there, so the control path doesn't touch NetworkTables (see AllocationGuard)
+        frc::SmartDashboard::PutBoolean("elbow switch", !elbowSwitch()); // elbow is Normally Open because c'est messed up
+        frc::SmartDashboard::PutBoolean("shoulder switch", shoulderSwitch()); // shoulder is, as proper, Normally Closed
+        frc::SmartDashboard::PutBoolean("Arm path clear", trajectory && trajectory -> clear);
+        frc::SmartDashboard::PutNumber("Shoulder goal", sAng);
+        frc::SmartDashboard::PutNumber("Elbow goal", eAng);
+        frc::SmartDashboard::PutNumber("Head Goal X", goalPos.x);
+        frc::SmartDashboard::PutNumber("Head Goal Y", goalPos.y);
         //armGoToPos(lowPole);
         //frc::SmartDashboard::PutNumber("Shoulder goal", GetShoulderGoalFrom(goal));
         //frc::SmartDashboard::PutNumber("Elbow goal", GetElbowGoalFrom(goal));
@@ -172,36 +354,39 @@ public:
         //frc::SmartDashboard::PutNumber("Elbow goal ticks", ElbowAngleToEncoderTicks(GetElbowGoalFrom(goal), GetShoulderGoalFrom(goal)));
     }
 
-    GrabMode grabMode;
+    GrabMode grabMode = OFF; // Set with SetGrab before each Update; Update uses it up
     
     void goToHome(bool triggerSol = false) {
-        armGoToPos({35, 0});
+        goToPreset(PRESET_HOME);
     }
 
     void goToPickup() {
-        armGoToPos({100, 0});
+        goToPreset(PRESET_PICKUP);
     }
 
     void goToLowPole() {
-        armGoToPos({lowPole});
+        goToPreset(PRESET_LOW_POLE);
     }
 
     void goToHighPole() {
-        armGoToPos({highPole});
+        goToPreset(PRESET_HIGH_POLE);
+    }
+
+    void goToPreset(ArmPresetID id) {
+        preset = &armPresets[id];
+        goalPos = preset -> head;
     }
 
     bool checkSwitches() {
-        frc::SmartDashboard::PutBoolean("elbow switch", !elbowLimitSwitch.Get()); // elbow is Normally Open because c'est messed up
-        frc::SmartDashboard::PutBoolean("shoulder switch", shoulderLimitSwitch.Get()); // shoulder is, as proper, Normally Closed
         bool zero = true;
-        if (shoulderLimitSwitch.Get()){
-            shoulderDefaultEncoderTicks = shoulderEncoder.GetValue();
+        if (shoulderSwitch()){
+            shoulderDefaultEncoderTicks = shoulderValue();
         }
         else {
             zero = false;
         }
-        if (!elbowLimitSwitch.Get()){
-            elbowDefaultEncoderTicks = elbowEncoder.GetValue();
+        if (!elbowSwitch()){
+            elbowDefaultEncoderTicks = elbowValue();
         }
         else {
             zero = false;
@@ -209,16 +394,31 @@ public:
         return zero;
     }
 
-    void armGoToPos(vector pos) {
+    /**
+     * Send the head somewhere. Goals the arm can't get to (out of reach, past a joint limit, in an obstacle) go to the nearest place it can, going by map;
+     * if there's nowhere near, the goal is rejected and the arm keeps going where it was going.
+     @returns false if the goal was rejected
+     */
+    bool armGoToPos(vector pos) {
+        JointAngles solved = ArmIK(pos.x, pos.y);
+        ArmJoints joints = ToArmJoints(solved);
+        if (!solved.reachable || !map.Allowed(joints)){
+            if (!map.Nearest(joints)){
+                return false;
+            }
+            pos = ArmFK(joints.shoulder, joints.shoulder + joints.elbow);
+        }
         goalPos = pos;
+        preset = nullptr;
+        return true;
     }
 
-    int GetNormalizedShoulder(){
-        return smartLoop(shoulderDefaultEncoderTicks - shoulderEncoder.GetValue());
+    double GetNormalizedShoulder(){
+        return smartLoop(shoulderDefaultEncoderTicks - shoulderValue());
     }
 
-    int GetNormalizedElbow(){
-        return smartLoop(elbowDefaultEncoderTicks - elbowEncoder.GetValue());
+    double GetNormalizedElbow(){
+        return smartLoop(elbowDefaultEncoderTicks - elbowValue());
     }
 
     double GetShoulderPos(){ // Get the shoulder angle in degrees relative to the ground
@@ -241,16 +441,8 @@ public:
     }
 
     ArmPosition GetArmPosition(){
-        ArmPosition ret;
-        double shoulderRads = GetShoulderRadians();
-        double elbowRads = GetElbowRadians();
-        double elbowX = cos(elbowRads) * elbowBarLengthCM;
-        double elbowY = sin(elbowRads) * elbowBarLengthCM;
-        double shoulderX = cos(shoulderRads) * shoulderBarLengthCM;
-        double shoulderY = sin(shoulderRads) * shoulderBarLengthCM;
-        ret.x = shoulderX + elbowX;
-        ret.y = shoulderY + elbowY;
-        return ret;
+        vector head = ArmFK(GetShoulderRadians(), GetElbowRadians());
+        return { (float)head.x, (float)head.y };
     }
 
     double ElbowAngleToEncoderTicks(double ang, double shoulder){
@@ -277,7 +469,7 @@ public:
             }
             else {
                 armGoToPos({setX, -10});
-                hand -> SetPercent(.35);
+                hand.SetPercent(.35);
                 setX += .005;
                 if (Has() || setX > 150) {
                     retract = true;
@@ -289,17 +481,31 @@ public:
     double sAng, eAng;
 
     bool atGoal(){
-        return (std::abs(shoulderEncoder.GetValue() - sAng) < 15) && (std::abs(elbowEncoder.GetValue() - eAng) < 15);
+        return (std::abs(shoulderValue() - sAng) < 15) && (std::abs(elbowValue() - eAng) < 15);
     }
 
     bool zeroed = false;
 
     void Update(){
-        shoulderWatcher -> Update();
-        elbowWatcher -> Update();
+        // Intake until the beam break sees something (its interrupt stops the hand the moment it does); barf whatever. The mode ain't sticky - don't want breakies
+        handMode = grabMode == INTAKE && Has() ? OFF : grabMode;
+        hand.SetPercent((handMode == BARF ? -handSpeed : (handMode == INTAKE ? handSpeed : 0)) * handScale);
+        grabMode = OFF;
+        if (sensorThread){
+            if (!sensed){
+                return; // Nothing to go on until the sensor thread's first snapshot
+            }
+        }
+        else { // No sensor thread, so this is the only thing sampling the encoders: once per Update
+            shoulderEncoder.Sample();
+            elbowEncoder.Sample();
+        }
+        shoulderWatcher.Update(shoulderCurrent());
+        elbowWatcher.Update(elbowCurrent());
         if (!zeroed){
-            AuxSetPercent(0.2, 0.1);
+            driveJoints(0.2, 0.1);
             zeroed = checkSwitches();
+            trajectory = nullptr; // Arm moved without a plan; plan from wherever it ends up
             return;
         }
         if (retract){
@@ -309,36 +515,49 @@ public:
             }
         }
         checkSwitches();
-        if (elbowWatcher -> isEndangered || shoulderWatcher -> isEndangered){
-            AuxSetPercent(0, 0);
+        if (elbowWatcher.isEndangered || shoulderWatcher.isEndangered){
+            driveJoints(0, 0);
+            trajectory = nullptr;
             return;
         }
         ArmPosition pos = GetArmPosition();
         info.goal = goalPos;
         info.curHeadX = pos.x;
         info.curHeadY = pos.y;
-        info.Update();
-        //info.RestrictOutputs(shoulderDefaultAngle, 0, 360, elbowDefaultAngle);
-        if (pos.x > 25 && pos.x < 55) { // Shoulder has to go up if it's finna clear the bumper
-            info.n = 80;
+        if (preset){
+            info.Set(preset -> joints); // Solved at compile time
+        }
+        else {
+            info.Update();
+            //info.RestrictOutputs(shoulderDefaultAngle, 0, 360, elbowDefaultAngle);
         }
-        sAng = ShoulderAngleToEncoderTicks(info.n);
+        sAng = ShoulderAngleToEncoderTicks(info.n); // Where it's finally going, for atGoal
         eAng = ElbowAngleToEncoderTicks(info.omega, info.n);
-        shoulderController -> SetPosition(sAng);
-        elbowController -> SetPosition(eAng);
-        frc::SmartDashboard::PutNumber("Shoulder goal", sAng);
-        frc::SmartDashboard::PutNumber("Elbow goal", eAng);
-        frc::SmartDashboard::PutNumber("Head Goal X", goalPos.x);
-        frc::SmartDashboard::PutNumber("Head Goal Y", goalPos.y);
 
-        shoulderController -> Update(shoulderEncoder.GetValue());
-        elbowController -> Update(elbowEncoder.GetValue());
-
-        grabMode = OFF; // ain't sticky - don't want breakies
+        ArmJoints goal = ToArmJoints(info.joints);
+        if (!trajectory || goal.shoulder != plannedGoal.shoulder || goal.elbow != plannedGoal.elbow){ // New goal: plan a way there from here
+            ArmJoints current = ToArmJoints({ GetShoulderRadians(), GetElbowRadians(), true });
+            ArmJoints via = preset ? ToArmJoints(preset -> clearance) : goal;
+            trajectory = &planner.Plan(current, goal, preset ? &via : nullptr);
+            plannedGoal = goal;
+            trajectoryStart = Clock::Now();
+        }
+        ArmSample target = trajectory -> Sample(Clock::Now() - trajectoryStart);
+        double targetShoulder = target.position.shoulder * 180/PI;
+        double targetElbow = (target.position.shoulder + target.position.elbow) * 180/PI - 10;
+        shoulderController.SetPosition(ShoulderAngleToEncoderTicks(targetShoulder));
+        elbowController.SetPosition(ElbowAngleToEncoderTicks(targetElbow, targetShoulder));
+        // Hold it up and push it along. Encoder ticks go up with the shoulder and down with the elbow (relative to the shoulder), so the elbow's feedforward is backwards
+        ArmTorques torques = ArmInverseDynamics(target, dynamics, Has());
+        shoulderController.feedforward = ArmJointOutput(0, torques.shoulder, target.velocity.shoulder, dynamics);
+        elbowController.feedforward = -ArmJointOutput(1, torques.elbow, target.velocity.elbow, dynamics);
+        shoulderController.Update(shoulderValue());
+        elbowController.Update(elbowValue());
+        holdLimits();
     }
 
     bool Has(){
-        return !boop.Get();
+        return !boopValue();
     }
 
     void SetGrab(GrabMode mode){
@@ -346,27 +565,53 @@ public:
     }
 
     bool shoulderAtLimit(){ // These do *not* return the state of the limit switch; they return whether or not the respective motor is at its limit. Thus they also include watchers in their math.
-        return shoulderLimitSwitch.Get() || shoulderWatcher -> isEndangered;
+        return shoulderSwitch() || shoulderWatcher.isEndangered;
     }
 
     bool elbowAtLimit(){
-        return !elbowLimitSwitch.Get() || elbowWatcher -> isEndangered;
+        return !elbowSwitch() || elbowWatcher.isEndangered;
     }
 
-    void Zero(){
-        zeroed = false;
+    /**
+     * Stop either joint the controllers are pushing into its limit. The switches' interrupts stop the motors as they close; this keeps them stopped until they open.
+     * Same rule as AuxSetPercent: positive output is towards the switches.
+     */
+    void holdLimits(){
+        if ((shoulderAtLimit() || shoulderHit) && shoulderController.GetOutput() > 0){
+            shoulder.SetPercent(0);
+        }
+        if ((elbowAtLimit() || elbowHit) && elbowController.GetOutput() > 0){
+            elbow.SetPercent(0);
+        }
     }
 
-    void AuxSetPercent(double s, double e){
-        shoulderWatcher -> Update();
-        elbowWatcher -> Update();
-        if ((shoulderAtLimit() && (s > 0)) || shoulderWatcher -> isEndangered){
+    /**
+     * Drive the joints directly, keeping them off their limits and off anything the CurrentWatchers say they're stuck on
+     */
+    void driveJoints(double s, double e){
+        shoulderWatcher.Update(shoulderCurrent());
+        elbowWatcher.Update(elbowCurrent());
+        if (((shoulderAtLimit() || shoulderHit) && (s > 0)) || shoulderWatcher.isEndangered){
             s = 0;
         }
-        if ((elbowAtLimit() && (e > 0)) || elbowWatcher -> isEndangered){
+        if (((elbowAtLimit() || elbowHit) && (e > 0)) || elbowWatcher.isEndangered){
             e = 0;
         }
-        shoulder -> SetPercent(s);
-        elbow -> SetPercent(e);
+        shoulder.SetPercent(s * shoulderScale);
+        elbow.SetPercent(e * elbowScale);
+    }
+
+    void Zero(){
+        zeroed = false;
+    }
+
+    /**
+     * Manual control, instead of Update. Update's what runs the hand, so this stops it (and drops whatever SetGrab asked for) rather than leave it going.
+     */
+    void AuxSetPercent(double s, double e){
+        hand.SetPercent(0);
+        grabMode = OFF;
+        handMode = OFF;
+        driveJoints(s, e);
     }
 };
\ No newline at end of file
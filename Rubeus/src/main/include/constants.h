@@ -1,27 +1,94 @@
+/* The robot's hardware, described once, constexpr.
+    Every device in Robot.cpp is built from this, in static storage; the static_asserts at the bottom catch two devices on one CAN id before it ever gets to the robot.
+*/
 #pragma once
 
-#define BACK_RIGHT_DIREC     1
-#define BACK_RIGHT_SPEED     2
-#define BACK_RIGHT_CANCODER  9 // this one is good
+#include <FRL/swerve/SwerveModule.hpp>
 
-#define FRONT_RIGHT_DIREC    4
-#define FRONT_RIGHT_SPEED    3
-#define FRONT_RIGHT_CANCODER 11
 
-#define FRONT_LEFT_DIREC     5
-#define FRONT_LEFT_SPEED     6
-#define FRONT_LEFT_CANCODER  12
+struct ArmConfig {
+    int shoulderID;
+    int elbowID;
+    int handID;
+};
 
-#define BACK_LEFT_DIREC      7 // this one is good
-#define BACK_LEFT_SPEED      8
-#define BACK_LEFT_CANCODER   10
 
+struct RobotDescription {
+    SwerveModuleConfig frontLeft;
+    SwerveModuleConfig frontRight;
+    SwerveModuleConfig backLeft;
+    SwerveModuleConfig backRight;
+    ArmConfig arm;
+    double swerveVelocityToMPS; // Spark velocity is wheel motor RPM; 6.75:1 reduction, 4 inch wheels
 
-#define FRONT_LEFT_OFFSET  1190
-#define FRONT_RIGHT_OFFSET 3808
-#define BACK_LEFT_OFFSET   1569
-#define BACK_RIGHT_OFFSET  2635
+    /**
+     * True if no two Spark MAXes share a CAN id. (CANCoders are a different device type, so they can reuse Spark ids; they just can't reuse each other's.)
+     */
+    constexpr bool UniqueSparkIDs() const {
+        int ids[] = {
+            frontLeft.speedID, frontLeft.directionID, frontRight.speedID, frontRight.directionID,
+            backLeft.speedID, backLeft.directionID, backRight.speedID, backRight.directionID,
+            arm.shoulderID, arm.elbowID, arm.handID
+        };
+        return unique(ids);
+    }
 
-#define ARM_SHOULDER 15
-#define ARM_ELBOW    14
-#define ARM_HAND     13
\ No newline at end of file
+    constexpr bool UniqueCANCoderIDs() const {
+        int ids[] = { frontLeft.cancoderID, frontRight.cancoderID, backLeft.cancoderID, backRight.cancoderID };
+        return unique(ids);
+    }
+
+private:
+    template <size_t Count>
+    static constexpr bool unique(const int (&ids)[Count]){
+        for (size_t i = 0; i < Count; i ++){
+            for (size_t j = i + 1; j < Count; j ++){
+                if (ids[i] == ids[j]){
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+};
+
+
+constexpr RobotDescription hardware {
+    .frontLeft = {
+        .speedID = 6,
+        .directionID = 5,
+        .cancoderID = 12,
+        .role = 1,
+        .offset = -1024 + 1190
+    },
+    .frontRight = {
+        .speedID = 3,
+        .directionID = 4,
+        .cancoderID = 11,
+        .role = 2,
+        .offset = 1024 + 3808
+    },
+    .backLeft = {
+        .speedID = 8,
+        .directionID = 7, // this one is good
+        .cancoderID = 10,
+        .role = 4,
+        .offset = 1024 + 1569
+    },
+    .backRight = {
+        .speedID = 2,
+        .directionID = 1,
+        .cancoderID = 9, // this one is good
+        .role = 3,
+        .offset = -1024 + 2635
+    },
+    .arm = {
+        .shoulderID = 15,
+        .elbowID = 14,
+        .handID = 13
+    },
+    .swerveVelocityToMPS = 0.000788
+};
+
+static_assert(hardware.UniqueSparkIDs(), "Two Spark MAXes in constants.h have the same CAN id");
+static_assert(hardware.UniqueCANCoderIDs(), "Two CANCoders in constants.h have the same CAN id");
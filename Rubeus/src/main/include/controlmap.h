@@ -0,0 +1,60 @@
+/* Which button does what. Every device gets one DeviceMap; MakeDevice refuses to compile anything that collides. */
+#pragma once
+
+#include "controls.hpp"
+
+
+constexpr AxisCurve speedLimitCurve { .scale = 0.5, .offset = 0.5 }; // -1..1 -> 0..1
+
+
+constexpr auto xboxMap = MakeDevice(4,
+    std::array {
+        ButtonBinding { ARM_INTAKE, 1 },
+        ButtonBinding { ARM_BARF, 2 },
+        ButtonBinding { ZERO_NAVX, 3 },
+        ButtonBinding { ELBOW_CONTROL, 5 },
+        ButtonBinding { SHOULDER_CONTROL, 6 }
+    },
+    std::array {
+        CoordBinding { LEFT_X, 0 },
+        CoordBinding { LEFT_Y, 1 },
+        CoordBinding { RIGHT_X, 3 },
+        CoordBinding { RIGHT_Y, 4 }
+    },
+    std::array<AxisBinding, 0> {}
+);
+
+
+constexpr auto joystickMap = MakeDevice(3,
+    std::array {
+        ButtonBinding { ELBOW_CONTROL, 2 },
+        ButtonBinding { ARM_BARF, 3 },
+        ButtonBinding { SHOULDER_CONTROL, 4 },
+        ButtonBinding { ARM_INTAKE, 5 },
+        ButtonBinding { ZERO_NAVX, 6 }
+    },
+    std::array {
+        CoordBinding { LEFT_X, 0 },
+        CoordBinding { LEFT_Y, 1 },
+        CoordBinding { RIGHT_X, 2 },
+        CoordBinding { RIGHT_Y, 2 } // Twist does both
+    },
+    std::array {
+        AxisBinding { SPEED_LIMIT, 3, speedLimitCurve }
+    }
+);
+
+
+constexpr auto buttonboardMap = MakeDevice(5,
+    std::array {
+        ButtonBinding { ARM_PICKUP, 3 },
+        ButtonBinding { TOGGLE_OPTION_3, 6 },
+        ButtonBinding { KEY, 7 },
+        ButtonBinding { TOGGLE_OPTION_1, 10 },
+        ButtonBinding { ZERO, 13 }
+    },
+    std::array<CoordBinding, 0> {},
+    std::array {
+        AxisBinding { SPEED_LIMIT, 0, speedLimitCurve } // This one is flipped
+    }
+);
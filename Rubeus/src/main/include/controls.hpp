@@ -1,148 +1,365 @@
 #pragma once
 
-#include <frc/GenericHID.h>
-#include <frc/XboxController.h>
-#include <frc/Joystick.h>
-
-enum Buttons {
-    ELBOW_CONTROL = 1,
-    ARM_BARF  = 5,
-    ARM_INTAKE = 3,
-    INTAKE_MACRO = 4,
-    ARM_PICKUP = 5,
-    ZERO_NAVX = 6,
-    SHOULDER_CONTROL = 7, 
-    TOGGLE_OPTION_1 = 8,
-    TOGGLE_OPTION_3 = 9,
-    STOP_MACROS = 10,
-    KEY = 11,
-    ZERO = 12
+#include <cstdint>
+#include <array>
+#include <utility>
+#include <hal/DriverStation.h>
+#include <FRL/util/Clock.hpp>
+
+enum Buttons { // No explicit values: these are bit numbers, and two actions sharing a number is exactly the bug this used to have
+    ELBOW_CONTROL,
+    ARM_BARF,
+    ARM_INTAKE,
+    INTAKE_MACRO,
+    ARM_PICKUP,
+    ZERO_NAVX,
+    SHOULDER_CONTROL,
+    TOGGLE_OPTION_1,
+    TOGGLE_OPTION_3,
+    STOP_MACROS,
+    KEY,
+    ZERO,
+    BUTTON_COUNT
 };
+static_assert(BUTTON_COUNT <= 32, "Buttons have to fit in the snapshot's uint32_t");
 
 
 enum Axis {
-    TRIM = 1,
-    SPEED_LIMIT = 2
+    TRIM,
+    SPEED_LIMIT,
+    AXIS_COUNT
 };
 
 
 enum Coords {
-    LEFT_X = 1,
-    LEFT_Y = 2,
-    RIGHT_X = 3,
-    RIGHT_Y = 4
+    LEFT_X,
+    LEFT_Y,
+    RIGHT_X,
+    RIGHT_Y,
+    COORD_COUNT
 };
 
 
-template <int ButtonboardID, int XboxID, int JoystickID>
-class Controls {
-    frc::GenericHID buttonboard {ButtonboardID};
-    frc::GenericHID xbox {XboxID};
-    frc::GenericHID joy {JoystickID};
+/**
+ * Response curve for an axis: deadband, then expo, then scale and offset.
+ * output = offset + scale * curved(raw), where curved is 0 inside the deadband and rescaled to reach +-1 outside it.
+ */
+struct AxisCurve {
+    float deadband = 0;
+    float expo = 0; // 0 = linear, 1 = cubic
+    float scale = 1;
+    float offset = 0;
 
-    std::map<Buttons, bool> usedButtonStates;
-    
-    std::map<Axis, float> usedAxis;
-    std::map<Coords, float> usedCoords;
+    constexpr float operator()(float raw) const {
+        float mag = raw < 0 ? -raw : raw;
+        if (mag <= deadband){
+            return offset;
+        }
+        float x = (mag - deadband) / (1 - deadband);
+        x = (1 - expo) * x + expo * x * x * x;
+        return offset + scale * (raw < 0 ? -x : x);
+    }
+};
 
-    bool buttonPressedStates[13];
-    bool buttonReleasedStates[13];
-    bool buttonToggledStates[13];
 
-public:
-    Controls() {
-        for (int x = 0; x < 13; x ++) {
-            buttonPressedStates[x] =  false;
-            buttonReleasedStates[x] = false;
-            buttonToggledStates[x] =  false;
+struct ButtonBinding {
+    Buttons action;
+    int button; // 1-indexed, same as GetRawButton
+};
+
+
+struct CoordBinding {
+    Coords action;
+    int axis;
+    AxisCurve curve = {};
+};
+
+
+struct AxisBinding {
+    Axis action;
+    int axis;
+    AxisCurve curve = {};
+};
+
+
+/**
+ * Lookup table version of an AxisCurve: 257 points over -1..1, linearly interpolated. DS axes are 8 bit, so this is as good as the real thing.
+ */
+struct AxisLUT {
+    float points[257];
+
+    constexpr float operator()(float raw) const {
+        float pos = (raw + 1) * 128;
+        if (pos <= 0){
+            return points[0];
         }
+        if (pos >= 256){
+            return points[256];
+        }
+        int i = (int)pos;
+        float t = pos - i;
+        return points[i] + (points[i + 1] - points[i]) * t;
     }
+};
 
-    void update() {
-        if (xbox.IsConnected()) {            
-            usedCoords[LEFT_X] = xbox.GetRawAxis(0);
-            usedCoords[LEFT_Y] = xbox.GetRawAxis(1);
-            usedCoords[RIGHT_X] = xbox.GetRawAxis(3);
-            usedCoords[RIGHT_Y] = xbox.GetRawAxis(4);
-            usedButtonStates[ARM_BARF] = xbox.GetRawButton(2);
-            usedButtonStates[ARM_INTAKE] = xbox.GetRawButton(1);
-            usedButtonStates[ZERO_NAVX] = xbox.GetRawButton(3);
-            usedButtonStates[ELBOW_CONTROL] = xbox.GetRawButton(5);
-            usedButtonStates[SHOULDER_CONTROL] = xbox.GetRawButton(6);
-        }
-        if (joy.IsConnected()) {
-            usedCoords[LEFT_X] = joy.GetRawAxis(0);
-            usedCoords[LEFT_Y] = joy.GetRawAxis(1);
-            usedCoords[RIGHT_X] = joy.GetRawAxis(2);
-            usedCoords[RIGHT_Y] = joy.GetRawAxis(2);
-            usedAxis[SPEED_LIMIT] = (joy.GetRawAxis(3) + 1)/2;
-            usedButtonStates[ELBOW_CONTROL] = joy.GetRawButton(2);
-            usedButtonStates[SHOULDER_CONTROL] = joy.GetRawButton(4);
-            usedButtonStates[ARM_BARF] = joy.GetRawButton(3);
-            usedButtonStates[ARM_INTAKE] = joy.GetRawButton(5);
-            usedButtonStates[ZERO_NAVX] = joy.GetRawButton(6);
-        }
-        if (buttonboard.IsConnected()) {
-            usedAxis[SPEED_LIMIT] = (buttonboard.GetRawAxis(0) + 1) / 2;                // This one is flipped
-            usedButtonStates[KEY] = buttonboard.GetRawButton(7);
-            usedButtonStates[TOGGLE_OPTION_1] = buttonboard.GetRawButton(10);
-            usedButtonStates[TOGGLE_OPTION_3] = buttonboard.GetRawButton(6);
-            usedButtonStates[ARM_PICKUP] = buttonboard.GetRawButton(3);
-            usedButtonStates[ZERO] = buttonboard.GetRawButton(13);
+
+constexpr AxisLUT MakeAxisLUT(AxisCurve curve){
+    AxisLUT ret {};
+    for (int i = 0; i <= 256; i ++){
+        ret.points[i] = curve(i / 128.0f - 1);
+    }
+    return ret;
+}
+
+
+/**
+ @version 1.0
+
+ * Everything one device is bound to. Make these with MakeDevice, which checks the bindings for collisions at compile time, and hand them to Controls.
+ */
+template <size_t ButtonCount, size_t CoordCount, size_t AxisCount>
+struct DeviceMap {
+    int port;
+    std::array<ButtonBinding, ButtonCount> buttons;
+    std::array<CoordBinding, CoordCount> coords;
+    std::array<AxisBinding, AxisCount> axes;
+    std::array<AxisLUT, CoordCount> coordCurves;
+    std::array<AxisLUT, AxisCount> axisCurves;
+};
+
+
+/**
+ * Build a DeviceMap. consteval, so any collision is a compile error, not a mystery on the field:
+ * an action bound twice on one device, one physical button bound to two actions, or something out of range.
+ @param port Driver station port
+ @param buttons Button bindings
+ @param coords Stick bindings
+ @param axes Other axis bindings
+ */
+template <size_t ButtonCount, size_t CoordCount, size_t AxisCount>
+consteval DeviceMap<ButtonCount, CoordCount, AxisCount> MakeDevice(int port, std::array<ButtonBinding, ButtonCount> buttons, std::array<CoordBinding, CoordCount> coords, std::array<AxisBinding, AxisCount> axes){
+    if (port < 0 || port > 5){
+        throw "Driver station ports are 0-5";
+    }
+    for (size_t i = 0; i < ButtonCount; i ++){
+        if (buttons[i].button < 1 || buttons[i].button > 32){
+            throw "Buttons are numbered 1-32";
+        }
+        for (size_t j = i + 1; j < ButtonCount; j ++){
+            if (buttons[i].action == buttons[j].action){
+                throw "Same action bound to two buttons on one device";
+            }
+            if (buttons[i].button == buttons[j].button){
+                throw "Same button bound to two actions";
+            }
+        }
+    }
+    for (size_t i = 0; i < CoordCount; i ++){
+        if (coords[i].axis < 0 || coords[i].axis >= HAL_kMaxJoystickAxes){
+            throw "Axis out of range";
+        }
+        for (size_t j = i + 1; j < CoordCount; j ++){
+            if (coords[i].action == coords[j].action){
+                throw "Same coord bound twice on one device";
+            }
         }
     }
+    for (size_t i = 0; i < AxisCount; i ++){
+        if (axes[i].axis < 0 || axes[i].axis >= HAL_kMaxJoystickAxes){
+            throw "Axis out of range";
+        }
+        for (size_t j = i + 1; j < AxisCount; j ++){
+            if (axes[i].action == axes[j].action){
+                throw "Same axis bound twice on one device";
+            }
+        }
+    }
+    DeviceMap<ButtonCount, CoordCount, AxisCount> ret { port, buttons, coords, axes, {}, {} };
+    for (size_t i = 0; i < CoordCount; i ++){
+        ret.coordCurves[i] = MakeAxisLUT(coords[i].curve);
+    }
+    for (size_t i = 0; i < AxisCount; i ++){
+        ret.axisCurves[i] = MakeAxisLUT(axes[i].curve);
+    }
+    return ret;
+}
 
-    bool GetButton(Buttons button) {
-        return usedButtonStates[button];
+
+/**
+ * One device's worth of joystick data, out of an HIDState.
+ * Same accessors as frc::GenericHID, but every axis and button comes out of the same read, so they're all from the same DS packet
+ * (GenericHID goes back through DriverStation's lock for every single button).
+ */
+struct HIDFrame {
+    const HAL_JoystickAxes& axes;
+    const HAL_JoystickButtons& buttons;
+
+    bool IsConnected() const {
+        return axes.count > 0 || buttons.count > 0;
     }
 
-    bool GetButtonPressed(Buttons button) {
-        if (!GetButton(button)) {
-            buttonPressedStates[(int)button - 1] = true;
+    float GetRawAxis(int axis) const {
+        if (axis < 0 || axis >= axes.count){
+            return 0;
         }
-        else if (buttonPressedStates[(int)button - 1]) {
-            buttonPressedStates[(int)button - 1] = false;
-            return true;
+        return axes.axes[axis];
+    }
+
+    bool GetRawButton(int button) const { // Buttons are 1-indexed, same as GenericHID
+        if (button < 1 || button > buttons.count){
+            return false;
         }
-        return false;
+        return buttons.buttons & (1u << (button - 1));
     }
+};
 
-    bool GetButtonReleased(Buttons button) {
-        if (GetButton(button)) {
-            buttonReleasedStates[(int)button - 1] = true;
+
+/**
+ * Every joystick port at once: one HAL call per tick, however many devices there are.
+ */
+struct HIDState {
+    HAL_JoystickAxes axes[HAL_kMaxJoysticks] {};
+    HAL_JoystickPOVs povs[HAL_kMaxJoysticks] {}; // Unused, but it comes with the read
+    HAL_JoystickButtons buttons[HAL_kMaxJoysticks] {};
+
+    void Read(){
+        HAL_GetAllJoystickData(axes, povs, buttons);
+    }
+
+    HIDFrame Port(int port) const {
+        return { axes[port], buttons[port] };
+    }
+};
+
+
+/**
+ * Everything the controls said during one tick. Built once in Controls::update() and never touched again until the next update,
+ * so asking the same question twice in a tick always gets the same answer.
+ */
+struct ControlsSnapshot {
+    uint32_t buttons = 0; // Bit n is set if Buttons value n is held
+    uint32_t pressed = 0; // Bits that went down this tick
+    uint32_t released = 0; // Bits that went up this tick
+    float coords[COORD_COUNT] = {}; // Indexed by Coords
+    float axis[AXIS_COUNT] = {}; // Indexed by Axis
+    double time = 0; // FPGA timestamp (seconds) the devices were read at
+
+    bool Get(Buttons button) const {
+        return buttons & (1u << button);
+    }
+
+    void Set(Buttons button, bool state){
+        if (state){
+            buttons |= 1u << button;
         }
-        else if (buttonReleasedStates[(int)button - 1]) {
-            buttonReleasedStates[(int)button - 1] = false;
-            return true;
+        else{
+            buttons &= ~(1u << button);
         }
-        return false;
     }
+};
 
-    bool GetButtonToggled(Buttons button) {
-        if (GetButtonReleased(button)) {
-            buttonToggledStates[(int)button] =! buttonToggledStates[(int)button];
+
+/**
+ @version 1.0
+
+ * All the driver controls. Devices are DeviceMaps (see controlmap.h), read in order, so later devices win when two are bound to the same action.
+
+ * The maps are template parameters, so update() unrolls into straight-line reads - no tables to walk at runtime.
+ */
+template <const auto&... Devices>
+class Controls {
+    static_assert(sizeof...(Devices) > 0, "Controls needs at least one device");
+
+    ControlsSnapshot snapshot;
+    uint32_t toggled = 0; // Flips on every release
+    HIDState hid;
+
+    /**
+     * Read one device into the snapshot. The index_sequence folds expand every binding into its own line of code.
+     */
+    template <const auto& Device>
+    void readDevice(ControlsSnapshot& next){
+        static_assert(Device.port >= 0 && Device.port < HAL_kMaxJoysticks, "Joystick port out of range");
+        HIDFrame frame = hid.Port(Device.port);
+        if (!frame.IsConnected()){
+            return; // Disconnected devices keep their last values
         }
-        return buttonToggledStates[(int)button];
+        [&]<size_t... I>(std::index_sequence<I...>){
+            (next.Set(Device.buttons[I].action, frame.GetRawButton(Device.buttons[I].button)), ...);
+        }(std::make_index_sequence<Device.buttons.size()>{});
+        [&]<size_t... I>(std::index_sequence<I...>){
+            ((next.coords[Device.coords[I].action] = Device.coordCurves[I](frame.GetRawAxis(Device.coords[I].axis))), ...);
+        }(std::make_index_sequence<Device.coords.size()>{});
+        [&]<size_t... I>(std::index_sequence<I...>){
+            ((next.axis[Device.axes[I].action] = Device.axisCurves[I](frame.GetRawAxis(Device.axes[I].axis))), ...);
+        }(std::make_index_sequence<Device.axes.size()>{});
+    }
+
+public:
+    /**
+     * Read every device and build this tick's snapshot. Call it at the *top* of the tick, before anything acts on the controls.
+     */
+    void update() {
+        ControlsSnapshot next = snapshot;
+        hid.Read();
+        next.time = Clock::Now();
+        (readDevice<Devices>(next), ...);
+        uint32_t changed = next.buttons ^ snapshot.buttons; // One XOR gets every edge at once
+        next.pressed = changed & next.buttons;
+        next.released = changed & snapshot.buttons;
+        toggled ^= next.released;
+        snapshot = next;
+    }
+
+    /**
+     * The whole snapshot, for anything that wants to look at more than one thing at once.
+     */
+    const ControlsSnapshot& Snapshot() {
+        return snapshot;
+    }
+
+    bool GetButton(Buttons button) {
+        return snapshot.Get(button);
+    }
+
+    bool GetButtonPressed(Buttons button) {
+        return snapshot.pressed & (1u << button);
+    }
+
+    bool GetButtonReleased(Buttons button) {
+        return snapshot.released & (1u << button);
+    }
+
+    bool GetButtonToggled(Buttons button) {
+        return toggled & (1u << button);
     }
 
     void ResetToggle(Buttons button) {
-        buttonToggledStates[(int)button] = false;
+        toggled &= ~(1u << button);
+    }
+
+    /**
+     * Seconds since the controls were read off the HAL. Call it right after commanding the motors and you've got how long the tick took to act on them.
+     * That's only our end: the time the DS packet spent getting here isn't in it (the HAL doesn't say when it arrived).
+     */
+    double Age() {
+        return Clock::Now() - snapshot.time;
     }
 
     float LeftX() {
-        return usedCoords[LEFT_X];
+        return snapshot.coords[LEFT_X];
     }
     float LeftY() {
-        return usedCoords[LEFT_Y];
+        return snapshot.coords[LEFT_Y];
     }
     float RightX() {
-        return usedCoords[RIGHT_X];
+        return snapshot.coords[RIGHT_X];
     }
     float RightY() {
-        return usedCoords[RIGHT_Y];
+        return snapshot.coords[RIGHT_Y];
     }
     float GetSpeedLimit() {
-        return usedAxis[SPEED_LIMIT];
+        return snapshot.axis[SPEED_LIMIT];
     }
     short GetOption() {
         if (GetButton(TOGGLE_OPTION_1)) {
@@ -0,0 +1,28 @@
+/* GENERATED by fieldmap.py from the layouts in fieldmaps/ - don't edit this, edit the JSON. */
+#pragma once
+
+#include "FieldMap.hpp"
+
+constexpr ApriltagPosition apriltags_makerspace[] = {
+    { 1, 0.0, 0.0, 0.0, 0.0, 1.0 },
+    { 5, 0.0, 1.0, 0.0, 0.0, 1.0 },
+    { 3, 0.0, -1.5, 0.0, 0.0, 1.0 },
+    { 6, 0.0, -3.125, 0.0, 0.0, 1.0 },
+    { 4, 3.1, -1.0, 3.141592653589793, 1.2246467991473532e-16, -1.0 },
+    { 8, 3.1, -2.8, 3.141592653589793, 1.2246467991473532e-16, -1.0 },
+};
+constexpr auto field_makerspace = MakeFieldMap(apriltags_makerspace);
+static_assert(!field_makerspace.duplicateIDs, "fieldmaps/makerspace.json has two tags with the same ID");
+
+constexpr ApriltagPosition apriltags_official[] = {
+    { 1, 0.0, 0.0, 0.0, 0.0, 1.0 },
+    { 2, 0.0, -1.65, 0.0, 0.0, 1.0 },
+    { 3, 0.0, -3.3, 0.0, 0.0, 1.0 },
+    { 4, -0.73, -5.51, 0.0, 0.0, 1.0 },
+    { 5, 14.53, -5.6, 3.141592653589793, 1.2246467991473532e-16, -1.0 },
+    { 6, 13.8, -3.3, 3.141592653589793, 1.2246467991473532e-16, -1.0 },
+    { 7, 13.8, -1.65, 3.141592653589793, 1.2246467991473532e-16, -1.0 },
+    { 8, 13.8, 0.0, 3.141592653589793, 1.2246467991473532e-16, -1.0 },
+};
+constexpr auto field_official = MakeFieldMap(apriltags_official);
+static_assert(!field_official.duplicateIDs, "fieldmaps/official.json has two tags with the same ID");
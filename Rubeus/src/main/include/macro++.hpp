@@ -356,7 +356,7 @@ public:
 			return !ret;
 		}
 		else if (c == "getStored"){
-			Object& name = PopStack();
+			Object name = PopStack();
 			assert(name.type == STRING);
 			std::string id = name.getString();
 			assert(global.contains(id));
@@ -364,7 +364,7 @@ public:
 			PushStack(f);
 		}
 		else if (c == "store"){
-			Object& name = PopStack();
+			Object name = PopStack();
 			assert(name.type == STRING);
 			std::string id = name.getString();
 			global[id] = PopStack();
@@ -404,8 +404,8 @@ public:
 		std::cout << "============= Stack end ============" << std::endl;
 	}
 	
-	Object& PopStack(){ // todo: refcounting? idk
-		Object& ret = PeekStack();
+	Object PopStack(){ // Returns a copy: the erase below destroys the original
+		Object ret = PeekStack();
 		stack.erase(stack.end() - shift);
 		return ret;
 	}
@@ -0,0 +1,167 @@
+/* Arm interrupt tests: what InterruptInput latches on an edge, the arm's switches and beam break stopping their motors straight from the interrupt,
+    and the loop keeping them stopped until they let go. Runs a simulated arm (FRL/sim); simulated interrupts fire inside SimDigitalInput::Set, so it's all one thread.
+*/
+
+#define PI 3.141592
+
+#include <frc/smartdashboard/SmartDashboard.h>
+#include <FRL/sim/SimWorld.hpp>
+#include <FRL/sim/SimSensors.hpp>
+#include <arm.hpp>
+
+#include "gtest/gtest.h"
+
+
+namespace {
+    constexpr int BoopChannel = 3;
+    constexpr int ElbowSwitchChannel = 4;
+    constexpr int ShoulderSwitchChannel = 5;
+
+    using SimArm = Arm<SimMotor, 1, 2, BoopChannel, ElbowSwitchChannel, ShoulderSwitchChannel, SimAnalogInput, SimDigitalInput>;
+
+    void set(int channel, bool level){
+        SimDigitalInput::ByID(channel) -> Set(level);
+    }
+
+    void tap(int channel){ // On and off again, between two loops
+        SimDigitalInput* input = SimDigitalInput::ByID(channel);
+        input -> Set(!input -> Get());
+        input -> Set(!input -> Get());
+    }
+
+    double applied(SimMotor& motor){ // What the motor's doing, once it's had a physics step to take the last command
+        SimWorld::Step(SimMotor::SubStep);
+        return motor.Applied();
+    }
+
+    /**
+     * A simulated arm with both switches open (away from their limits) and the hand empty
+     */
+    struct ArmInterruptTest : testing::Test {
+        SimArm arm { 10, 11, 12 };
+
+        void SetUp() override {
+            SimClock::Install();
+            arm.shoulderEncoder.Raw().Attach(&arm.shoulder, 100, 1000);
+            arm.elbowEncoder.Raw().Attach(&arm.elbow, 100, 2000);
+            set(ShoulderSwitchChannel, false); // Normally Closed
+            set(ElbowSwitchChannel, true); // Normally Open
+            set(BoopChannel, true);
+        }
+    };
+}
+
+
+TEST(InterruptInputTest, LatchesEdges) {
+    SimClock::Install();
+    InterruptInput<SimDigitalInput> input { 20 };
+    int calls = 0;
+    bool last = true;
+    input.Start([&](bool level){
+        calls ++;
+        last = level;
+    });
+    EXPECT_TRUE(input.Level()); // Read once at Start
+    EXPECT_EQ(input.Edges(), 0u);
+    SimClock::Advance(1.5);
+    input.Raw().Set(false);
+    EXPECT_FALSE(input.Level());
+    EXPECT_EQ(input.Edges(), 1u);
+    EXPECT_DOUBLE_EQ(input.LastEdge(), 1.5);
+    EXPECT_EQ(calls, 1);
+    EXPECT_FALSE(last);
+    SimClock::Advance(0.25);
+    input.Raw().Set(true);
+    EXPECT_TRUE(input.Level());
+    EXPECT_EQ(input.Edges(), 2u);
+    EXPECT_DOUBLE_EQ(input.LastEdge(), 1.75);
+    EXPECT_TRUE(last);
+    input.Raw().Set(true); // Not an edge
+    EXPECT_EQ(calls, 2);
+}
+
+TEST_F(ArmInterruptTest, SwitchStopsJointImmediately) {
+    arm.AuxSetPercent(0.5, 0.5);
+    ASSERT_DOUBLE_EQ(applied(arm.elbow), 0.5);
+    set(ElbowSwitchChannel, false); // At the limit, mid-loop
+    EXPECT_DOUBLE_EQ(applied(arm.elbow), 0); // Stopped by the interrupt, not a loop later
+    EXPECT_DOUBLE_EQ(applied(arm.shoulder), 0.5);
+    EXPECT_TRUE(arm.elbowHit);
+    arm.AuxSetPercent(0.5, 0.5);
+    EXPECT_DOUBLE_EQ(applied(arm.elbow), 0); // The loop doesn't drive it back in
+    arm.AuxSetPercent(0.5, 0.5);
+    EXPECT_DOUBLE_EQ(applied(arm.elbow), 0); // However many loops it's there for
+    arm.AuxSetPercent(0, -0.5);
+    EXPECT_DOUBLE_EQ(applied(arm.elbow), -0.5); // Backing off a limit is always fine
+}
+
+TEST_F(ArmInterruptTest, HeldUntilRelease) {
+    arm.AuxSetPercent(0.5, 0.5);
+    set(ShoulderSwitchChannel, true);
+    EXPECT_DOUBLE_EQ(applied(arm.shoulder), 0);
+    for (int i = 0; i < 3; i ++){
+        arm.AuxSetPercent(0.5, 0.5);
+        EXPECT_DOUBLE_EQ(applied(arm.shoulder), 0);
+    }
+    set(ShoulderSwitchChannel, false); // Let go
+    EXPECT_FALSE(arm.shoulderHit);
+    arm.AuxSetPercent(0.5, 0.5);
+    EXPECT_DOUBLE_EQ(applied(arm.shoulder), 0.5);
+    tap(ShoulderSwitchChannel); // Bounced on and off between loops: stopped for the moment it was on
+    EXPECT_DOUBLE_EQ(applied(arm.shoulder), 0);
+}
+
+TEST_F(ArmInterruptTest, GrabModeNeverSticks) {
+    ASSERT_FALSE(arm.zeroed); // So Update returns early, zeroing
+    arm.SetGrab(BARF);
+    arm.Update();
+    EXPECT_DOUBLE_EQ(applied(arm.hand), -arm.handSpeed);
+    arm.Update();
+    EXPECT_DOUBLE_EQ(applied(arm.hand), 0);
+    arm.SetGrab(INTAKE);
+    arm.Update();
+    EXPECT_DOUBLE_EQ(applied(arm.hand), arm.handSpeed);
+    arm.Update();
+    EXPECT_DOUBLE_EQ(applied(arm.hand), 0);
+}
+
+TEST_F(ArmInterruptTest, ManualControlStopsHand) {
+    arm.SetGrab(INTAKE);
+    arm.Update();
+    ASSERT_DOUBLE_EQ(applied(arm.hand), arm.handSpeed);
+    arm.AuxSetPercent(0, 0.3); // Skips Update, so it has to stop the hand itself
+    EXPECT_DOUBLE_EQ(applied(arm.hand), 0);
+    arm.SetGrab(BARF);
+    arm.AuxSetPercent(0, 0); // Drops the request too
+    arm.Update();
+    EXPECT_DOUBLE_EQ(applied(arm.hand), 0);
+}
+
+TEST_F(ArmInterruptTest, BeamBreakStopsIntake) {
+    arm.SetGrab(INTAKE);
+    arm.Update();
+    ASSERT_DOUBLE_EQ(applied(arm.hand), arm.handSpeed);
+    set(BoopChannel, false); // Got one
+    EXPECT_TRUE(arm.Has());
+    EXPECT_DOUBLE_EQ(applied(arm.hand), 0); // Straight away
+    arm.SetGrab(INTAKE);
+    arm.Update();
+    EXPECT_DOUBLE_EQ(applied(arm.hand), 0); // And it stays stopped while there's something there
+    arm.SetGrab(BARF);
+    arm.Update();
+    EXPECT_DOUBLE_EQ(applied(arm.hand), -arm.handSpeed);
+    set(BoopChannel, true);
+    set(BoopChannel, false); // Breaking the beam doesn't stop a barf
+    EXPECT_DOUBLE_EQ(applied(arm.hand), -arm.handSpeed);
+    set(BoopChannel, true);
+    arm.SetGrab(INTAKE);
+    arm.Update();
+    EXPECT_DOUBLE_EQ(applied(arm.hand), arm.handSpeed); // Nothing there now; back to it
+}
+
+TEST_F(ArmInterruptTest, HandTakesItsScale) {
+    arm.SetOutputScale(1, 1, 0.5); // Derated: a hot hand motor
+    arm.SetGrab(INTAKE);
+    arm.Update();
+    EXPECT_DOUBLE_EQ(applied(arm.hand), arm.handSpeed * 0.5);
+}
@@ -0,0 +1,112 @@
+/* Arm kinematics tests: ArmIK against the degree-based solver it replaced, over a dense grid of goals, plus FK round trips and atan2Fast's accuracy.
+*/
+
+#define PI 3.141592
+
+#include <cmath>
+#include <ArmKinematics.hpp>
+
+#include "gtest/gtest.h"
+
+
+namespace {
+    double loop360(double angle){ // smartLoop(angle, 360), without dragging PIDController in
+        while (angle > 360){
+            angle -= 360;
+        }
+        while (angle < 0){
+            angle += 360;
+        }
+        return angle;
+    }
+
+    /**
+     * The arm's old solver (ArmInfo::Update before ArmIK), kept as it was: degrees, isosceles-triangle geometry, and the 10 degree elbow calibration offset baked into omega.
+     */
+    struct OldArmSolve {
+        double n; // Shoulder, degrees
+        double omega; // Elbow bar, degrees, less 10
+
+        OldArmSolve(vector goal){
+            double x = loop360(goal.angle() * 180/PI);
+            double theta = loop360(asin(goal.magnitude() / 2 / shoulderBarLengthCM) * 180/PI * 2);
+            double f = loop360((180 - theta) / 2);
+            n = loop360(f + x);
+            double y = loop360(90 - n);
+            double a = loop360(theta - y);
+            omega = loop360(270 + a - 10);
+        }
+    };
+
+    double angleDiff(double a, double b){ // Degrees, the short way round
+        return std::abs(std::remainder(a - b, 360));
+    }
+}
+
+
+TEST(ArmKinematicsTest, MatchesOldSolver) {
+    double worst = 0;
+    long goals = 0;
+    for (double x = -180; x <= 180; x += 1){
+        for (double y = -180; y <= 180; y += 1){
+            double distance = std::hypot(x, y);
+            if (distance < 1 || distance > shoulderBarLengthCM + elbowBarLengthCM){
+                continue;
+            }
+            OldArmSolve old { { x, y } };
+            JointAngles solved = ArmIK(x, y);
+            ASSERT_TRUE(solved.reachable) << x << ", " << y;
+            double n = solved.shoulder * 180/cexpr::pi;
+            double omega = solved.elbow * 180/cexpr::pi - 10;
+            worst = std::max({ worst, angleDiff(n, old.n), angleDiff(omega, old.omega) });
+            goals ++;
+        }
+    }
+    EXPECT_GT(goals, 100000);
+    EXPECT_LT(worst, 0.05); // Degrees. An encoder tick is 0.088
+}
+
+TEST(ArmKinematicsTest, OutOfReach) {
+    JointAngles solved = ArmIK(300, 0);
+    EXPECT_FALSE(solved.reachable);
+    vector head = ArmFK(solved.shoulder, solved.elbow); // Stretched straight out towards it
+    EXPECT_NEAR(head.x, shoulderBarLengthCM + elbowBarLengthCM, 0.1);
+    EXPECT_NEAR(head.y, 0, 0.1);
+}
+
+TEST(ArmKinematicsTest, ForwardUndoesInverse) {
+    double worst = 0;
+    for (double x = -150; x <= 150; x += 2){
+        for (double y = -150; y <= 150; y += 2){
+            double distance = std::hypot(x, y);
+            if (distance < 1 || distance > 180){
+                continue;
+            }
+            JointAngles solved = ArmIK(x, y);
+            vector head = ArmFK(solved.shoulder, solved.elbow);
+            worst = std::max(worst, std::hypot(head.x - x, head.y - y));
+        }
+    }
+    EXPECT_LT(worst, 0.1); // cm
+}
+
+TEST(ArmKinematicsTest, ConstexprMatchesRuntime) {
+    constexpr JointAngles compiled = ArmIK(130, 76.36);
+    volatile double x = 130; // So this one really does get solved at runtime
+    JointAngles runtime = ArmIK(x, 76.36);
+    EXPECT_DOUBLE_EQ(compiled.shoulder, runtime.shoulder);
+    EXPECT_DOUBLE_EQ(compiled.elbow, runtime.elbow);
+}
+
+TEST(ArmKinematicsTest, Atan2FastAccuracy) {
+    double worst = 0;
+    for (int i = 0; i < 3600; i ++){
+        double angle = i * 2 * cexpr::pi / 3600;
+        for (double r : { 0.01, 1.0, 250.0 }){
+            double y = r * std::sin(angle);
+            double x = r * std::cos(angle);
+            worst = std::max(worst, std::abs(std::remainder(cexpr::atan2Fast(y, x) - std::atan2(y, x), 2 * cexpr::pi)));
+        }
+    }
+    EXPECT_LT(worst, 2 * cexpr::pi / 4096 / 4); // A quarter of an encoder tick
+}
@@ -0,0 +1,92 @@
+/* ArmMap tests: the deployed map agrees with ArmAllowed, and a map built from different constants (or none at all) falls back to ArmAllowed.
+*/
+
+#define PI 3.141592
+
+#include <cstdio>
+#include <vector>
+#include <ArmMap.hpp>
+
+#include "gtest/gtest.h"
+
+
+namespace {
+    constexpr double deg = cexpr::pi / 180;
+
+    /**
+     * Write a map file that says everything is allowed, built for the given constants
+     */
+    std::string writeMap(const ArmPlannerConstants& constants){
+        std::string path = testing::TempDir() + "armmap_test.bin";
+        ArmMapHeader header { { 'A', 'R', 'M', 'M' }, (uint32_t)ArmMap::Size, ArmMap::ShoulderMin, ArmMap::ElbowMin, ArmMap::CellSize, ArmMap::Hash(constants) };
+        std::vector<uint8_t> bits(ArmMap::Bytes, 0xff);
+        FILE* file = fopen(path.c_str(), "wb");
+        fwrite(&header, sizeof(header), 1, file);
+        fwrite(bits.data(), 1, bits.size(), file);
+        fclose(file);
+        return path;
+    }
+}
+
+
+TEST(ArmMapTest, DeployedMapIsCurrent) {
+    // Fails if the obstacles or limits changed without rerunning the armMap tool
+    ArmPlannerConstants constants;
+    ArmMap map { constants };
+    std::string source = __FILE__;
+    std::string deployed = source.substr(0, source.rfind("test")) + "main/deploy/armmap.bin"; // Next to this file in src, wherever the tests run from
+    ASSERT_TRUE(map.Load(deployed));
+    int disagree = 0;
+    for (int s = 0; s < ArmMap::Size; s ++){
+        for (int e = 0; e < ArmMap::Size; e ++){
+            ArmJoints center { ArmMap::ShoulderMin + (s + 0.5) * ArmMap::CellSize, ArmMap::ElbowMin + (e + 0.5) * ArmMap::CellSize }; // What each bit stands for
+            disagree += map.Allowed(center) != ArmAllowed(center, constants);
+        }
+    }
+    EXPECT_LE(disagree, ArmMap::Size); // A few cells right on an edge can round either way, same as the tool allows
+}
+
+TEST(ArmMapTest, HashCoversObstaclesAndLimits) {
+    ArmPlannerConstants constants;
+    uint64_t hash = ArmMap::Hash(constants);
+    ArmPlannerConstants moved = constants;
+    moved.obstacles[1].maxY += 1;
+    EXPECT_NE(ArmMap::Hash(moved), hash);
+    ArmPlannerConstants limited = constants;
+    limited.maxJoints[0] -= deg;
+    EXPECT_NE(ArmMap::Hash(limited), hash);
+    ArmPlannerConstants spaced = constants;
+    spaced.clearance = 0;
+    EXPECT_NE(ArmMap::Hash(spaced), hash);
+    ArmPlannerConstants faster = constants;
+    faster.maxVelocity[0] *= 2; // Doesn't change where the arm can be
+    EXPECT_EQ(ArmMap::Hash(faster), hash);
+}
+
+TEST(ArmMapTest, StaleMapFallsBack) {
+    ArmPlannerConstants constants;
+    ArmJoints inBumper = ToArmJoints(ArmIK(40, -25));
+    ASSERT_FALSE(ArmAllowed(inBumper, constants));
+
+    ArmPlannerConstants old = constants;
+    old.obstacleCount = 0;
+    ArmMap map { constants };
+    EXPECT_FALSE(map.Load(writeMap(old))); // Built before the bumper was there
+    EXPECT_FALSE(map.Loaded());
+    EXPECT_FALSE(map.Allowed(inBumper)); // So ArmAllowed gets asked
+    ArmJoints nearest = inBumper;
+    ASSERT_TRUE(map.Nearest(nearest, 64));
+    EXPECT_TRUE(ArmAllowed(nearest, constants));
+
+    EXPECT_TRUE(map.Load(writeMap(constants))); // This one says everything's fine, and it's current, so it's believed
+    EXPECT_TRUE(map.Allowed(inBumper));
+    std::remove((testing::TempDir() + "armmap_test.bin").c_str());
+}
+
+TEST(ArmMapTest, MissingFile) {
+    ArmPlannerConstants constants;
+    ArmMap map { constants };
+    EXPECT_FALSE(map.Load("no/such/armmap.bin"));
+    EXPECT_FALSE(map.Allowed({ 0, 30 * deg })); // Past the elbow's limit
+    EXPECT_TRUE(map.Allowed({ 60 * deg, -80 * deg }));
+}
@@ -0,0 +1,142 @@
+/* ArmPlanner tests: straight moves, ways round the bumper that never touch anything, the profiles along them, and the cache.
+*/
+
+#define PI 3.141592
+
+#include <cmath>
+#include <ArmTrajectory.hpp>
+
+#include "gtest/gtest.h"
+
+
+namespace {
+    ArmPlanner planner; // Static: its A* state is around 80 kB
+
+    constexpr double deg = cexpr::pi / 180;
+
+    /**
+     * Walk a trajectory every 5 ms, checking it stays out of the real obstacles (no clearance) and inside the joint and profile limits.
+     */
+    void expectFollowable(const ArmTrajectory& move, const ArmJoints& start, const ArmJoints& goal){
+        ArmPlannerConstants real = planner.constants;
+        real.clearance = 0;
+        ArmSample first = move.Sample(0);
+        EXPECT_NEAR(first.position.shoulder, start.shoulder, 1e-9);
+        EXPECT_NEAR(first.position.elbow, start.elbow, 1e-9);
+        EXPECT_NEAR(move.End().shoulder, goal.shoulder, 1e-9);
+        EXPECT_NEAR(move.End().elbow, goal.elbow, 1e-9);
+        for (int i = 1; i < move.count; i ++){ // Each line starts where the last one ended
+            const ArmSegment& last = move.segments[i - 1];
+            EXPECT_NEAR(move.segments[i].start.shoulder, last.start.shoulder + last.delta.shoulder, 1e-9);
+            EXPECT_NEAR(move.segments[i].start.elbow, last.start.elbow + last.delta.elbow, 1e-9);
+        }
+        for (double t = 0; t <= move.Duration() + 0.005; t += 0.005){
+            ArmSample at = move.Sample(t);
+            ASSERT_TRUE(ArmAllowed(at.position, real)) << "at " << t << "s: " << at.position.shoulder / deg << ", " << at.position.elbow / deg;
+            EXPECT_LE(std::abs(at.velocity.shoulder), real.maxVelocity[0] + 1e-9);
+            EXPECT_LE(std::abs(at.velocity.elbow), real.maxVelocity[1] + 1e-9);
+        }
+        ArmSample last = move.Sample(move.Duration());
+        EXPECT_NEAR(last.velocity.shoulder, 0, 1e-9); // Ends at rest
+        EXPECT_NEAR(last.velocity.elbow, 0, 1e-9);
+    }
+}
+
+
+TEST(ArmPlannerTest, SegmentProfile) {
+    ArmPlannerConstants constants;
+    ArmJoints from { 0, -90 * deg };
+    ArmJoints to { 60 * deg, -30 * deg };
+    ArmSegment segment = ArmSegment::Plan(from, to, constants);
+    // Both joints go 60 degrees, so the slower one (the shoulder) sets the pace
+    double distance = 60 * deg;
+    double v = constants.maxVelocity[0];
+    double a = constants.maxAcceleration[0];
+    double expected = v * v / a >= distance ? 2 * std::sqrt(distance / a) : distance / v + v / a;
+    EXPECT_NEAR(segment.duration, expected, 1e-9);
+    EXPECT_NEAR(segment.Sample(segment.duration / 2).position.shoulder, 30 * deg, 1e-9); // Symmetric, so halfway in time is halfway there
+    EXPECT_DOUBLE_EQ(segment.Sample(-1).position.elbow, from.elbow);
+    EXPECT_NEAR(segment.Sample(segment.duration + 1).position.elbow, to.elbow, 1e-9);
+    EXPECT_NEAR(segment.Sample(segment.duration + 1).velocity.shoulder, 0, 1e-9);
+
+    ArmSegment still = ArmSegment::Plan(from, from, constants);
+    EXPECT_EQ(still.duration, 0);
+    EXPECT_DOUBLE_EQ(still.Sample(0).position.shoulder, from.shoulder);
+}
+
+TEST(ArmPlannerTest, ClearLineGoesStraight) {
+    ArmJoints start { 50 * deg, -90 * deg };
+    ArmJoints goal { 80 * deg, -60 * deg };
+    ASSERT_TRUE(planner.PathClear(start, goal));
+    const ArmTrajectory& move = planner.Plan(start, goal);
+    EXPECT_TRUE(move.clear);
+    EXPECT_EQ(move.count, 1);
+    expectFollowable(move, start, goal);
+}
+
+TEST(ArmPlannerTest, GoesRoundObstacles) {
+    // Every pair of allowed positions on a coarse grid whose straight line isn't clear: each needs a clear way round, and following it mustn't hit anything
+    int blocked = 0;
+    for (double s0 = 0; s0 <= 82; s0 += 10){
+        for (double e0 = -160; e0 <= 0; e0 += 10){
+            ArmJoints start { s0 * deg, e0 * deg };
+            if (!ArmAllowed(start, planner.constants)){
+                continue;
+            }
+            for (double s1 = 0; s1 <= 82; s1 += 10){
+                for (double e1 = -160; e1 <= 0; e1 += 10){
+                    ArmJoints goal { s1 * deg, e1 * deg };
+                    if (!ArmAllowed(goal, planner.constants) || planner.PathClear(start, goal)){
+                        continue;
+                    }
+                    blocked ++;
+                    const ArmTrajectory& move = planner.Plan(start, goal);
+                    ASSERT_TRUE(move.clear) << s0 << ", " << e0 << " to " << s1 << ", " << e1;
+                    EXPECT_GT(move.count, 1);
+                    for (int i = 0; i < move.count; i ++){
+                        const ArmSegment& line = move.segments[i];
+                        EXPECT_TRUE(planner.PathClear(line.start, { line.start.shoulder + line.delta.shoulder, line.start.elbow + line.delta.elbow }));
+                    }
+                    expectFollowable(move, start, goal);
+                }
+            }
+        }
+    }
+    EXPECT_GT(blocked, 10); // Or this isn't testing anything: the obstacles must have moved
+}
+
+TEST(ArmPlannerTest, GoalInObstacle) {
+    ArmJoints start { 60 * deg, -60 * deg };
+    ArmJoints goal { 82 * deg, 30 * deg }; // Past the elbow's limit
+    const ArmTrajectory& move = planner.Plan(start, goal);
+    EXPECT_FALSE(move.clear);
+    EXPECT_EQ(move.count, 1); // Straight there, for whatever that's worth
+}
+
+TEST(ArmPlannerTest, CachesRepeats) {
+    ArmJoints start { 30 * deg, -100 * deg };
+    ArmJoints goal { 70 * deg, -10 * deg };
+    const ArmTrajectory& first = planner.Plan(start, goal);
+    const ArmTrajectory& again = planner.Plan({ start.shoulder + 0.2 * deg, start.elbow }, goal); // Same to the nearest degree
+    EXPECT_EQ(&first, &again);
+    const ArmTrajectory& other = planner.Plan(goal, start);
+    EXPECT_NE(&first, &other);
+    ArmTrajectory copy = first;
+    planner.Rebuild(); // Forgets them, but plans the same thing again
+    const ArmTrajectory& replanned = planner.Plan(start, goal);
+    EXPECT_EQ(replanned.count, copy.count);
+    EXPECT_DOUBLE_EQ(replanned.Duration(), copy.Duration());
+}
+
+TEST(ArmPlannerTest, ViaIsPartOfTheKey) {
+    ArmJoints start { 30 * deg, -100 * deg };
+    ArmJoints goal { 70 * deg, -10 * deg };
+    ArmJoints via { 60 * deg, -80 * deg };
+    ArmJoints otherVia { 40 * deg, -40 * deg };
+    const ArmTrajectory& without = planner.Plan(start, goal);
+    const ArmTrajectory& with = planner.Plan(start, goal, &via);
+    EXPECT_NE(&without, &with);
+    EXPECT_NE(&with, &planner.Plan(start, goal, &otherVia));
+    EXPECT_EQ(&with, &planner.Plan(start, goal, &via));
+    EXPECT_EQ(&without, &planner.Plan(start, goal));
+}
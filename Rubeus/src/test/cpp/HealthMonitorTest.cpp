@@ -0,0 +1,79 @@
+/* HealthMonitor tests: I²t heat building up and cooling off, the clamp at the budget, the derate curve, and the rolling window.
+    NEO limits unless it says otherwise: 40A continuous, 80A for 2s, so a budget of (80² - 40²) * 2 = 9600 A²s.
+*/
+
+#include <FRL/motor/HealthMonitor.hpp>
+
+#include "gtest/gtest.h"
+
+
+namespace {
+    constexpr double Budget = (80.0 * 80 - 40 * 40) * 2;
+
+    template <size_t Motors>
+    void run(HealthMonitor<Motors>& health, const double (&currents)[Motors], double seconds, double dt = 0.1){
+        for (int i = 0; i < (int)(seconds / dt + 0.5); i ++){
+            health.Record(currents, dt);
+        }
+    }
+}
+
+
+TEST(HealthMonitorTest, HeatIntegratesAboveContinuous) {
+    HealthMonitor<2> health;
+    run(health, { 60, 40 }, 1);
+    EXPECT_NEAR(health.Heat(0), (60.0 * 60 - 40 * 40) * 1 / Budget, 1e-9);
+    EXPECT_DOUBLE_EQ(health.Heat(1), 0); // Continuous is free, forever
+    EXPECT_DOUBLE_EQ(health.Derate(0), 1); // Nowhere near DerateStart
+    run(health, { 20, 0 }, 0.5); // Cools at the same rate it heated: (20² - 40²) * 0.5 = -600
+    EXPECT_NEAR(health.Heat(0), (2000.0 - 600) / Budget, 1e-9);
+    run(health, { 0, 0 }, 10);
+    EXPECT_DOUBLE_EQ(health.Heat(0), 0); // Never colder than cold
+}
+
+TEST(HealthMonitorTest, ClampsToBudget) {
+    HealthMonitor<1> health;
+    run(health, { 80 }, 10); // Five times as long as it's allowed
+    EXPECT_DOUBLE_EQ(health.Heat(0), 1);
+    EXPECT_DOUBLE_EQ(health.Derate(0), MotorThermalConstants{}.MinDerate);
+    run(health, { 0 }, 1); // Cooling off starts straight away, not after working off the extra 8 seconds
+    EXPECT_NEAR(health.Heat(0), (Budget - 40 * 40) / Budget, 1e-9);
+}
+
+TEST(HealthMonitorTest, DerateCurve) {
+    MotorThermalConstants c;
+    HealthMonitor<1> health;
+    double full = 80 * 80 - 40 * 40; // A²s per second at peak
+    run(health, { 80 }, c.DerateStart * Budget / full);
+    EXPECT_NEAR(health.Heat(0), c.DerateStart, 1e-9);
+    EXPECT_NEAR(health.Derate(0), 1, 1e-9); // Just starting
+    double more = (1 - c.DerateStart) / 2; // Halfway from DerateStart to the whole budget...
+    run(health, { 80 }, more * Budget / full);
+    EXPECT_NEAR(health.Derate(0), (1 + c.MinDerate) / 2, 1e-9); // ...is halfway down, in a straight line
+}
+
+TEST(HealthMonitorTest, PerMotorConstants) {
+    HealthMonitor<2> health;
+    health.SetConstants(1, NEO550_THERMAL);
+    run(health, { 30, 30 }, 1); // Under a NEO's continuous, well over a 550's
+    EXPECT_DOUBLE_EQ(health.Heat(0), 0);
+    double budget550 = (40.0 * 40 - 20 * 20) * 2;
+    EXPECT_NEAR(health.Heat(1), (30.0 * 30 - 20 * 20) / budget550, 1e-9);
+    run(health, { 30, 30 }, 5);
+    EXPECT_DOUBLE_EQ(health.Derate(0), 1);
+    EXPECT_DOUBLE_EQ(health.Derate(1), NEO550_THERMAL.MinDerate);
+}
+
+TEST(HealthMonitorTest, RollingWindow) {
+    HealthMonitor<1, 4> health;
+    EXPECT_EQ(health.Mean(0), 0);
+    for (double amps : { 1, 2, 3, 4, 5 }){
+        health.Record({ amps }, 0.02);
+    }
+    EXPECT_DOUBLE_EQ(health.Mean(0), 3.5); // The 1 dropped out
+    EXPECT_DOUBLE_EQ(health.Latest(0), 5);
+    health.Reset();
+    EXPECT_EQ(health.Mean(0), 0);
+    EXPECT_EQ(health.Latest(0), 0);
+    EXPECT_DOUBLE_EQ(health.Derate(0), 1);
+}
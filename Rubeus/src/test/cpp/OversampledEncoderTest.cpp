@@ -0,0 +1,160 @@
+/* OversampledEncoder tests: the filter, going the short way round through 0, and not believing averages taken across it.
+    A scripted input stands in for the FPGA, so each test says exactly what the averaging and accumulator hand back.
+*/
+
+#define PI 3.141592
+
+#include <cmath>
+#include <FRL/util/OversampledEncoder.hpp>
+#include <FRL/sim/SimSensors.hpp>
+#include <FRL/sim/SimClock.hpp>
+
+#include "gtest/gtest.h"
+
+
+namespace {
+    /**
+     * An analog input that reads back whatever it's told, in ticks: single is one sample, average is the FPGA's averaged value,
+     * and mean (if set) is what the accumulator saw since the last read. Channels 0 and 1 have accumulators, like the RIO's.
+     */
+    struct ScriptedAnalog {
+        bool accumulator;
+        double single = 0;
+        double average = 0;
+        double mean = -1;
+        int64_t sum = 0;
+        int64_t count = 0;
+
+        ScriptedAnalog(int channel) : accumulator { channel < 2 } {
+
+        }
+
+        void Set(double ticks){
+            single = ticks;
+            average = ticks;
+            mean = -1;
+        }
+
+        int GetValue(){
+            return (int)single;
+        }
+
+        void SetOversampleBits(int bits){
+
+        }
+
+        void SetAverageBits(int bits){
+
+        }
+
+        int GetAverageValue(){
+            return (int)(average * (1 << OversampledEncoder<ScriptedAnalog>::OversampleBits));
+        }
+
+        bool IsAccumulatorChannel(){
+            return accumulator;
+        }
+
+        void InitAccumulator(){
+
+        }
+
+        void GetAccumulatorOutput(int64_t& value, int64_t& n){
+            if (mean >= 0){ // 64 more samples, averaging mean
+                count += 64;
+                sum += (int64_t)std::llround(mean * 64 * (1 << OversampledEncoder<ScriptedAnalog>::OversampleBits));
+            }
+            value = sum;
+            n = count;
+        }
+
+        static double GetSampleRate(){
+            return 50000;
+        }
+    };
+
+    double distance(double a, double b){ // Ticks, the short way round
+        return std::abs(std::remainder(a - b, 4096));
+    }
+}
+
+
+TEST(OversampledEncoderTest, FilterHalvesSteps) {
+    OversampledEncoder<ScriptedAnalog> encoder { 2 };
+    encoder.Raw().Set(1000);
+    EXPECT_DOUBLE_EQ(encoder.Sample(), 1000); // The first reading is taken as it is
+    encoder.Raw().Set(1100);
+    EXPECT_DOUBLE_EQ(encoder.Sample(), 1050); // FilterShift 1: half of each step
+    EXPECT_DOUBLE_EQ(encoder.Sample(), 1075);
+    for (int i = 0; i < 20; i ++){
+        encoder.Sample();
+    }
+    EXPECT_NEAR(encoder.GetValue(), 1100, 0.01);
+}
+
+TEST(OversampledEncoderTest, ShortWayThroughZero) {
+    OversampledEncoder<ScriptedAnalog> encoder { 2 };
+    encoder.Raw().Set(4090);
+    encoder.Sample();
+    for (double ticks = 4090; ticks < 4096 + 30; ticks += 2){ // Turning slowly up through 0
+        encoder.Raw().Set(std::fmod(ticks, 4096));
+        double value = encoder.Sample();
+        EXPECT_GE(value, 0);
+        EXPECT_LT(value, 4096);
+        EXPECT_LT(distance(value, ticks), 4) << "at " << ticks; // Lagging a poll or so, never off round the other side
+    }
+}
+
+TEST(OversampledEncoderTest, IgnoresAveragesAcrossZero) {
+    // Sitting on 0, the FPGA averages some 4095s with some 0s and gets about 2048. That must never show up
+    OversampledEncoder<ScriptedAnalog> encoder { 2 };
+    encoder.Raw().Set(4094);
+    encoder.Sample();
+    for (int i = 0; i < 10; i ++){
+        encoder.Raw().single = i % 2 ? 1 : 4094;
+        encoder.Raw().average = 2048;
+        EXPECT_LT(distance(encoder.Sample(), 0), 4);
+    }
+}
+
+TEST(OversampledEncoderTest, IgnoresAccumulatorAcrossZero) {
+    // Away from 0 now, but the accumulator's mean for the poll caught the arm going through it
+    OversampledEncoder<ScriptedAnalog> encoder { 0 };
+    encoder.Raw().Set(100);
+    encoder.Sample();
+    for (int i = 0; i <= OversampledEncoder<ScriptedAnalog>::MaxRejected; i ++){ // More polls than the WrapGuard would hold off on its own
+        encoder.Raw().Set(100);
+        encoder.Raw().mean = 1500; // Nonsense: some samples near 4095
+        EXPECT_DOUBLE_EQ(encoder.Sample(), 100); // The latest average instead
+    }
+    encoder.Raw().mean = 104; // A good one is used
+    EXPECT_DOUBLE_EQ(encoder.Sample(), 102);
+}
+
+TEST(OversampledEncoderTest, WrapGuardHoldsThenGivesIn) {
+    OversampledEncoder<ScriptedAnalog> encoder { 2 };
+    encoder.Raw().Set(1000);
+    encoder.Sample();
+    encoder.Raw().Set(1000 + OversampledEncoder<ScriptedAnalog>::WrapGuard + 500); // Further than the arm can go in a poll
+    for (int i = 0; i < OversampledEncoder<ScriptedAnalog>::MaxRejected; i ++){
+        EXPECT_DOUBLE_EQ(encoder.Sample(), 1000); // Held
+    }
+    EXPECT_GT(encoder.Sample(), 1000); // Still there, so it's real
+    encoder.Raw().Set(1000);
+    for (int i = 0; i < 40; i ++){
+        encoder.Sample();
+    }
+    EXPECT_NEAR(encoder.GetValue(), 1000, 0.01); // And back
+}
+
+TEST(OversampledEncoderTest, GroupDelayUsesPollPeriod) {
+    SimClock::Install();
+    SimClock::Advance(1);
+    OversampledEncoder<SimAnalogInput> encoder { 0 };
+    encoder.Raw().Set(2000);
+    encoder.Sample();
+    SimClock::Advance(0.005);
+    EXPECT_NEAR(encoder.Sample(), 2000, 1);
+    double fpga = 63 / (2 * SimAnalogInput::GetSampleRate()); // 64 samples averaged
+    EXPECT_NEAR(encoder.GroupDelay(), fpga + 0.005, 1e-9); // No accumulator; one poll of filter
+}
@@ -0,0 +1,97 @@
+/* PoseHistory tests: interpolation, late corrections replayed over the motion since, and the ring wrapping round.
+    Everything runs on made-up timestamps, so these are deterministic.
+*/
+
+#define PI 3.141592
+
+#include <FRL/util/PoseHistory.hpp>
+
+#include "gtest/gtest.h"
+
+
+TEST(PoseHistoryTest, SampleInterpolates) {
+    PoseHistory<8> history;
+    history.Push(1.0, { 0, 0 });
+    history.Push(2.0, { 10, -4 });
+    vector out;
+    ASSERT_TRUE(history.Sample(1.25, out));
+    EXPECT_DOUBLE_EQ(out.x, 2.5);
+    EXPECT_DOUBLE_EQ(out.y, -1);
+    ASSERT_TRUE(history.Sample(1.0, out)); // Exactly on a sample
+    EXPECT_DOUBLE_EQ(out.x, 0);
+    ASSERT_TRUE(history.Sample(5.0, out)); // Newer than anything: the newest
+    EXPECT_DOUBLE_EQ(out.x, 10);
+    EXPECT_FALSE(history.Sample(0.5, out)); // Older than anything
+}
+
+TEST(PoseHistoryTest, EmptyAndOutOfOrder) {
+    PoseHistory<4> history;
+    vector out;
+    EXPECT_FALSE(history.Sample(0, out));
+    EXPECT_EQ(history.LatestTime(), -1);
+    history.Push(2.0, { 1, 1 });
+    history.Push(1.0, { 5, 5 }); // Older than the newest; dropped
+    EXPECT_EQ(history.Size(), 1u);
+    EXPECT_DOUBLE_EQ(history.Latest().x, 1);
+}
+
+TEST(PoseHistoryTest, CorrectReplaysMotionSince) {
+    // Driving along x at 1 m/s; a camera frame from t = 2 arrives at t = 4 saying we were really 0.5 m further up in y
+    PoseHistory<16> history;
+    for (int i = 0; i <= 4; i ++){
+        history.Push(i, { (double)i, 0 });
+    }
+    ASSERT_TRUE(history.Correct(2.0, { 2, 0.5 }));
+    EXPECT_DOUBLE_EQ(history.Latest().x, 4); // Motion since the frame kept
+    EXPECT_DOUBLE_EQ(history.Latest().y, 0.5);
+    vector out;
+    history.Sample(1.0, out);
+    EXPECT_DOUBLE_EQ(out.y, 0); // Before the frame: untouched
+    history.Sample(3.0, out);
+    EXPECT_DOUBLE_EQ(out.y, 0.5);
+    EXPECT_FALSE(history.Correct(-1.0, { 0, 0 })); // Too old to line up
+}
+
+TEST(PoseHistoryTest, CorrectBetweenSamples) {
+    PoseHistory<16> history;
+    history.Push(0.0, { 0, 0 });
+    history.Push(1.0, { 2, 0 });
+    history.Push(2.0, { 4, 0 });
+    ASSERT_TRUE(history.Correct(0.5, { 0, 0 })); // History said 1 at t = 0.5: 1 off. Everything from 0.5 on moves back 1
+    EXPECT_DOUBLE_EQ(history.Latest().x, 3);
+    vector out;
+    history.Sample(0.0, out);
+    EXPECT_DOUBLE_EQ(out.x, 0);
+}
+
+TEST(PoseHistoryTest, ShiftSince) {
+    PoseHistory<8> history;
+    for (int i = 0; i < 4; i ++){
+        history.Push(i, { 0, 0 });
+    }
+    history.Shift(2.0, { 1, 2 });
+    vector out;
+    history.Sample(1.0, out);
+    EXPECT_DOUBLE_EQ(out.x, 0);
+    history.Sample(2.0, out);
+    EXPECT_DOUBLE_EQ(out.x, 1);
+    EXPECT_DOUBLE_EQ(history.Latest().y, 2);
+}
+
+TEST(PoseHistoryTest, WrapsRound) {
+    PoseHistory<4> history;
+    for (int i = 0; i < 10; i ++){
+        history.Push(i, { (double)i * 10, 0 });
+    }
+    EXPECT_EQ(history.Size(), 4u); // Full; the oldest got overwritten
+    EXPECT_DOUBLE_EQ(history.LatestTime(), 9);
+    vector out;
+    EXPECT_FALSE(history.Sample(5.5, out)); // Gone
+    ASSERT_TRUE(history.Sample(6.5, out)); // Oldest left is 6, across the wrap from the newest
+    EXPECT_DOUBLE_EQ(out.x, 65);
+    ASSERT_TRUE(history.Correct(7.0, { 0, 0 }));
+    EXPECT_DOUBLE_EQ(history.Latest().x, 20);
+    history.Clear();
+    EXPECT_EQ(history.Size(), 0u);
+    EXPECT_FALSE(history.Sample(9, out));
+}
@@ -0,0 +1,92 @@
+/* PowerManager tests: the budget arithmetic, granting by priority, cutting straight away and recovering at RecoverRate,
+    and a full-stick launch from rest on a full battery not getting throttled.
+*/
+
+#include <algorithm>
+#include <FRL/motor/PowerManager.hpp>
+
+#include "gtest/gtest.h"
+
+
+namespace {
+    enum { DRIVE, ARM, COMPRESSOR, COUNT };
+
+    /**
+     * A PowerManager that believes each voltage it's told straight away, so the numbers can be worked out by hand
+     */
+    PowerManager<COUNT> unfiltered(){
+        PowerManager<COUNT> power;
+        power.constants.OpenVoltageFilter = 1;
+        return power;
+    }
+}
+
+
+TEST(PowerManagerTest, BudgetArithmetic) {
+    PowerManager<COUNT> power = unfiltered();
+    PowerConstants& c = power.constants;
+    power.Update(11, 100, { 0, 0, 0 }, 0.02);
+    double open = 11 + (100 + c.BaseLoad) * c.BatteryResistance; // Put back what the load sagged it by
+    EXPECT_NEAR(power.OpenVoltage(), open, 1e-9);
+    EXPECT_NEAR(power.Budget(), (open - c.TargetVoltage) / c.BatteryResistance - c.BaseLoad, 1e-9);
+    EXPECT_NEAR(power.PredictVoltage(100), 11, 1e-9); // Agrees with what it was told
+    EXPECT_NEAR(power.PredictVoltage(power.Budget()), c.TargetVoltage, 1e-9); // The whole budget sags it to exactly the target
+    EXPECT_DOUBLE_EQ(power.Scale(DRIVE), 1); // Nobody wants anything, so nobody's cut
+}
+
+TEST(PowerManagerTest, GrantsByPriority) {
+    PowerManager<COUNT> power = unfiltered();
+    PowerConstants& c = power.constants;
+    double voltage = 10;
+    power.Update(voltage, 0, { 100, 100, 50 }, 0.02);
+    double sag = c.TargetVoltage / voltage; // What each demand comes to with the battery down at the target
+    double budget = power.Budget();
+    ASSERT_GT(budget, 100 * sag);
+    ASSERT_LT(budget, 200 * sag);
+    EXPECT_DOUBLE_EQ(power.Scale(DRIVE), 1);
+    EXPECT_NEAR(power.Scale(ARM), (budget - 100 * sag) / (100 * sag), 1e-9); // Whatever's left
+    EXPECT_DOUBLE_EQ(power.Scale(COMPRESSOR), 0);
+}
+
+TEST(PowerManagerTest, CutsAtOnceRecoversSlowly) {
+    PowerManager<COUNT> power = unfiltered();
+    power.Update(10, 0, { 100, 100, 50 }, 0.02);
+    double cut = power.Scale(ARM);
+    ASSERT_LT(cut, 1);
+    ASSERT_EQ(power.Scale(COMPRESSOR), 0);
+    double dt = 0.1;
+    double step = power.constants.RecoverRate * dt;
+    power.Update(12.5, 0, { 0, 0, 50 }, dt); // Plenty to go round now
+    EXPECT_DOUBLE_EQ(power.Scale(ARM), std::min(cut + step, 1.0)); // Eases back, capped at 1
+    EXPECT_NEAR(power.Scale(COMPRESSOR), step, 1e-9);
+    power.Update(12.5, 0, { 0, 0, 50 }, dt);
+    EXPECT_NEAR(power.Scale(COMPRESSOR), 2 * step, 1e-9);
+    for (int i = 0; i < 20; i ++){
+        power.Update(12.5, 0, { 0, 0, 50 }, dt);
+    }
+    EXPECT_DOUBLE_EQ(power.Scale(COMPRESSOR), 1);
+    power.Update(10, 0, { 100, 100, 50 }, dt); // Squeezed again: down in one go
+    EXPECT_DOUBLE_EQ(power.Scale(COMPRESSOR), 0);
+    EXPECT_NEAR(power.Scale(ARM), cut, 1e-9);
+}
+
+TEST(PowerManagerTest, LaunchFromRestIsntThrottled) {
+    // Four NEOs at full command from standstill on a full battery, with the arm holding and the compressor running: the default constants have to let that through
+    PowerManager<COUNT> power;
+    double voltage = 12.5;
+    double stall = DCMotor{}.Current(1, 0, voltage);
+    power.Update(voltage, 0, { 4 * stall, 5, 12 }, 0.02);
+    EXPECT_DOUBLE_EQ(power.Scale(DRIVE), 1);
+    EXPECT_DOUBLE_EQ(power.Scale(ARM), 1);
+    EXPECT_DOUBLE_EQ(power.Scale(COMPRESSOR), 1);
+}
+
+TEST(PowerManagerTest, SaggingBatteryThrottles) {
+    // The same launch on a tired battery that's already down to 9V under a light load has to give
+    PowerManager<COUNT> power = unfiltered();
+    double voltage = 9;
+    power.Update(voltage, 20, { 4 * DCMotor{}.Current(1, 0, voltage), 5, 12 }, 0.02);
+    EXPECT_LT(power.Scale(DRIVE), 1);
+    EXPECT_GT(power.Scale(DRIVE), 0.3);
+    EXPECT_DOUBLE_EQ(power.Scale(COMPRESSOR), 0); // Last in line
+}
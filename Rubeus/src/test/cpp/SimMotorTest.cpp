@@ -0,0 +1,102 @@
+/* SimMotor tests: step responses against the DC motor model worked out by hand, brake and coast, and the registry and clock SimWorld runs on.
+*/
+
+#define PI 3.141592
+
+#include <cmath>
+#include <FRL/sim/SimWorld.hpp>
+
+#include "gtest/gtest.h"
+
+
+namespace {
+    constexpr SimMotorConstants frictionless { .Inertia = 0.0005, .Friction = 0 };
+
+    double kt(const SimMotorConstants& c){ // Nm per amp
+        return 60 / (2 * M_PI * c.motor.Kv);
+    }
+}
+
+
+TEST(SimMotorTest, StepResponse) {
+    // A first-order system: speed goes to Kv * V with time constant J R / kt²
+    SimClock::Install();
+    SimMotor motor { 1, frictionless };
+    double freeSpeed = frictionless.motor.Kv * frictionless.SupplyVoltage; // RPM
+    double tau = frictionless.Inertia * frictionless.motor.Resistance / (kt(frictionless) * kt(frictionless));
+    motor.SetPercent(1);
+    SimWorld::Step(SimMotor::SubStep);
+    EXPECT_NEAR(motor.GetCurrent(), 12 / frictionless.motor.Resistance, 2); // Stalled, so it's all resistance
+    SimWorld::Run(tau, SimMotor::SubStep, [](){});
+    EXPECT_NEAR(motor.GetVelocity() / freeSpeed, 1 - std::exp(-1), 0.02);
+    SimWorld::Run(10 * tau, 0.02, [](){});
+    EXPECT_NEAR(motor.GetVelocity(), freeSpeed, freeSpeed * 0.001);
+    EXPECT_NEAR(motor.GetCurrent(), 0, 0.5); // No load, no current at free speed
+    EXPECT_NEAR(SimClock::Now(), 11 * tau, 0.03);
+}
+
+TEST(SimMotorTest, HalfOutputHalfSpeed) {
+    SimClock::Install();
+    SimMotor motor { 1, frictionless };
+    motor.SetPercent(-0.5);
+    SimWorld::Run(2, 0.02, [](){});
+    EXPECT_NEAR(motor.GetVelocity(), -0.5 * frictionless.motor.Kv * 12, 5);
+}
+
+TEST(SimMotorTest, CoastAndBrake) {
+    SimClock::Install();
+    SimMotor coasting { 1, frictionless };
+    SimMotor braking { 2, frictionless };
+    braking.ConfigIdleToBrake();
+    coasting.SetState(0, 3000);
+    braking.SetState(0, 3000);
+    SimWorld::Run(1, 0.02, [](){});
+    EXPECT_NEAR(coasting.GetVelocity(), 3000, 1); // Open bridge: nothing slows it
+    double tau = frictionless.Inertia * frictionless.motor.Resistance / (kt(frictionless) * kt(frictionless));
+    EXPECT_NEAR(braking.GetVelocity(), 3000 * std::exp(-1 / tau), 0.5); // Shorted: back EMF decays it with the same time constant as a step
+}
+
+TEST(SimMotorTest, LoadTorqueStalls) {
+    // Stall torque is kt * V / R. Push back with exactly that at full output and it doesn't move
+    SimClock::Install();
+    SimMotor motor { 1, frictionless };
+    motor.SetLoadTorque(-kt(frictionless) * 12 / frictionless.motor.Resistance);
+    motor.SetPercent(1);
+    SimWorld::Run(1, 0.02, [](){});
+    EXPECT_NEAR(motor.GetVelocity(), 0, 1);
+}
+
+TEST(SimMotorTest, EncoderAndInversion) {
+    SimClock::Install();
+    SimMotor motor { 1 };
+    motor.SetPositionConversionFactor(2);
+    motor.SetState(3);
+    EXPECT_DOUBLE_EQ(motor.GetPosition(), 6);
+    motor.SetEncoderPosition(0);
+    EXPECT_NEAR(motor.GetPosition(), 0, 1e-9);
+    motor.SetState(4);
+    EXPECT_NEAR(motor.GetPosition(), 2, 1e-9);
+    EXPECT_DOUBLE_EQ(motor.Rotations(), 4); // The shaft, not the encoder
+}
+
+TEST(SimMotorTest, OnboardPositionLoop) {
+    SimClock::Install();
+    SimMotor motor { 1, { .Inertia = 0.0005, .Friction = 0.001 } };
+    motor.ConfigIdleToBrake();
+    motor.SetP(0.5);
+    motor.SetD(10);
+    motor.SetPositionPID(5);
+    SimWorld::Run(3, 0.02, [](){});
+    EXPECT_NEAR(motor.GetPosition(), 5, 0.05);
+    EXPECT_NEAR(motor.GetVelocity(), 0, 10);
+}
+
+TEST(SimMotorTest, Registry) {
+    SimMotor a { 7 };
+    EXPECT_EQ(SimMotor::ByID(7), &a);
+    {
+        SimMotor b { 8 };
+        EXPECT_EQ(SimMotor::ByID(8), &b);
+    }
+    EXPECT_EQ(SimMotor::ByID(8), nullptr); // Gone with it
+}
@@ -0,0 +1,31 @@
+/* Shared by the host tools (src/tune, src/armmap). Not robot code.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+
+/**
+ * Call f(i) for every i below count, spread over a pool of one worker per core. Workers take the next index as they finish, so slow ones don't hold anyone up.
+ * f gets called from several threads at once; anything it writes to has to be its own (a slot per i) or atomic.
+ */
+template <typename F>
+void parallelFor(size_t count, F f){
+    std::atomic<size_t> next = 0;
+    size_t workers = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::thread> pool;
+    for (size_t w = 0; w < workers; w ++){
+        pool.emplace_back([&](){
+            for (size_t i = next ++; i < count; i = next ++){
+                f(i);
+            }
+        });
+    }
+    for (std::thread& t : pool){
+        t.join();
+    }
+}
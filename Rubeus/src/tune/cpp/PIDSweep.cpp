@@ -0,0 +1,202 @@
+/* PID sweep. Host tool, not robot code.
+    Runs the steering loop and both arm joints in simulation (FRL/sim) with every combination of gains in a grid, on every core at once,
+    scores each run on settle time, overshoot and current, and prints the ones nothing else beats on all three.
+    Build the pidSweep component for desktop (./gradlew build) and run what it installs under build/install/pidSweep.
+*/
+
+#define PI 3.141592
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <FRL/sim/SimWorld.hpp>
+#include <FRL/sim/SimSensors.hpp>
+#include <FRL/swerve/SwerveModule.hpp>
+#include <ParallelFor.hpp>
+
+
+const double TICK = LOOP_PERIOD_MS / 1000.0; // Seconds per control loop
+const double RUN_TIME = 2; // Seconds each run gets to settle
+const double SETTLE_MARGIN = 20; // Ticks either side of the target that count as there
+
+
+/**
+ * How good one run was. Lower is better for all of them.
+ */
+struct Score {
+    double settleTime; // Seconds until it got within SETTLE_MARGIN and stayed there; RUN_TIME if it never did
+    double overshoot; // Worst distance past the target, in ticks
+    double current; // Mean motor current, amps
+
+    bool Dominates(const Score& other) const {
+        bool noWorse = settleTime <= other.settleTime && overshoot <= other.overshoot && current <= other.current;
+        bool better = settleTime < other.settleTime || overshoot < other.overshoot || current < other.current;
+        return noWorse && better;
+    }
+};
+
+
+/**
+ * Run a control loop at the robot's loop rate and watch it go for a target
+ @param target Where it's going, in ticks
+ @param motor The motor it's driving, for current
+ @param tick One loop of control code; returns where the mechanism is now, in ticks
+ */
+template <typename Tick>
+Score stepResponse(double target, SimMotor& motor, Tick tick){
+    Score ret { 0, 0, 0 };
+    double startSign = 0;
+    double currentSum = 0;
+    long ticks = 0;
+    SimWorld::Run(RUN_TIME, TICK, [&](){
+        double error = std::remainder(target - tick(), 4096); // Everything here is on a 4096 tick circle
+        if (startSign == 0){
+            startSign = error < 0 ? -1 : 1;
+        }
+        ret.overshoot = std::max(ret.overshoot, -startSign * error);
+        if (std::abs(error) > SETTLE_MARGIN){
+            ret.settleTime = (ticks + 1) * TICK;
+        }
+        currentSum += motor.GetCurrent();
+        ticks ++;
+    });
+    ret.current = currentSum / ticks;
+    return ret;
+}
+
+
+/**
+ * A swerve module turning 90 degrees, through the real SwerveModule code (the RIO PID path)
+ */
+Score steering(const PIDConstants& constants){
+    SimClock::Reset();
+    SwerveModule <SimMotor, SimMotor, SimCANCoder> module { SwerveModuleConfig { .speedID = 1, .directionID = 2, .cancoderID = 3, .role = 0, .offset = 0 } };
+    SimMotor* direction = SimMotor::ByID(2);
+    direction -> SetConstants({ .Inertia = 0.00008, .Friction = 0.0002 }); // Wheel and gearbox through 12.8:1, plus the rotor and scrub
+    SimCANCoder::ByID(3) -> Attach(direction, 12.8);
+    module.DirectionConstants() = constants;
+    return stepResponse(1024, *direction, [&](){
+        module.SetDirection(1024);
+        module.ApplySpeed();
+        return module.GetDirection();
+    });
+}
+
+
+/**
+ * One arm joint, the way Arm drives it: a PIDController on the motor, running off the analog encoder
+ */
+struct JointModel {
+    SimMotorConstants motor;
+    double ratio; // Motor rotations per joint rotation
+    double gravity; // Nm at the joint when it's horizontal
+    double start; // Ticks; 0 is horizontal
+    double target;
+};
+
+const JointModel SHOULDER { { .Inertia = 0.0001, .Friction = 0.0005 }, 100, 20, 900, 300 }; // Both bars, about 3kg each
+const JointModel ELBOW { { .Inertia = 0.00005, .Friction = 0.0005 }, 100, 10, 3000, 3600 };
+
+Score joint(const PIDConstants& constants, const JointModel& model){
+    SimClock::Reset();
+    SimMotor motor { 10, model.motor };
+    motor.ConfigIdleToBrake();
+    SimAnalogInput encoder { 0 };
+    encoder.Attach(&motor, model.ratio, model.start);
+    PIDController <SimMotor> controller { &motor };
+    controller.constants = constants;
+    controller.SetCircumference(4096);
+    controller.SetPosition(model.target);
+    return stepResponse(model.target, motor, [&](){
+        double angle = encoder.GetValue() * 2 * PI / 4096;
+        motor.SetLoadTorque(-model.gravity * cos(angle) / model.ratio);
+        controller.Update(encoder.GetValue());
+        return (double)encoder.GetValue();
+    });
+}
+
+
+/**
+ * Something to tune, and the gains it has on the robot now. The grid goes from 1/8 to 8 times the current P.
+ */
+struct Scenario {
+    const char* name;
+    PIDConstants current;
+    Score (*run)(const PIDConstants&);
+};
+
+const Scenario scenarios[] = {
+    { "steering", { .P = 0.0005, .MinOutput = -0.2, .MaxOutput = 0.2 }, steering },
+    { "shoulder", { .P = 0.0025, .MinOutput = -0.15, .MaxOutput = 0.15 }, [](const PIDConstants& c){ return joint(c, SHOULDER); } },
+    { "elbow", { .P = 0.005, .MinOutput = -0.25, .MaxOutput = 0.25 }, [](const PIDConstants& c){ return joint(c, ELBOW); } }
+};
+
+const double P_SCALES[] = { 0.125, 0.177, 0.25, 0.354, 0.5, 0.707, 1, 1.41, 2, 2.83, 4, 5.66, 8 };
+const double D_SCALES[] = { 0, 0.5, 1, 2, 4 }; // Times P
+const double OUTPUT_SCALES[] = { 0.5, 1, 2 }; // Times the current output limit; this is what sets how fast it slews
+
+
+struct Run {
+    const Scenario* scenario;
+    PIDConstants constants;
+    Score score;
+};
+
+
+int main(int argc, char** argv){
+    SimClock::Install();
+
+    std::vector<Run> runs;
+    for (const Scenario& scenario : scenarios){
+        if (argc > 1 && strcmp(argv[1], scenario.name) != 0){
+            continue;
+        }
+        for (double p : P_SCALES){
+            for (double d : D_SCALES){
+                for (double o : OUTPUT_SCALES){
+                    PIDConstants c = scenario.current;
+                    c.P *= p;
+                    c.D = c.P * d;
+                    c.MaxOutput = std::min(1.0, c.MaxOutput * o);
+                    c.MinOutput = std::max(-1.0, c.MinOutput * o);
+                    runs.push_back({ &scenario, c, {} });
+                }
+            }
+        }
+    }
+
+    parallelFor(runs.size(), [&](size_t i){
+        runs[i].score = runs[i].scenario -> run(runs[i].constants);
+    });
+
+    printf("scenario,P,I,D,MaxOutput,settleTime,overshoot,current\n");
+    for (const Scenario& scenario : scenarios){
+        std::vector<Run*> front;
+        for (Run& r : runs){
+            if (r.scenario != &scenario){
+                continue;
+            }
+            bool dominated = false;
+            for (Run& other : runs){
+                if (other.scenario == &scenario && other.score.Dominates(r.score)){
+                    dominated = true;
+                    break;
+                }
+            }
+            if (!dominated){
+                front.push_back(&r);
+            }
+        }
+        std::sort(front.begin(), front.end(), [](Run* a, Run* b){
+            return a -> score.settleTime < b -> score.settleTime;
+        });
+        for (Run* r : front){
+            printf("%s,%g,%g,%g,%g,%.2f,%.1f,%.2f\n", scenario.name, r -> constants.P, r -> constants.I, r -> constants.D, r -> constants.MaxOutput, r -> score.settleTime, r -> score.overshoot, r -> score.current);
+        }
+    }
+    fprintf(stderr, "%zu runs on %u threads\n", runs.size(), std::max(1u, std::thread::hardware_concurrency()));
+}